@@ -0,0 +1,567 @@
+/**
+ * bench.c - Harness nativo para medir o custo por quadro do jogo sem o runtime w4.
+ *
+ * Compila main.c na mesma unidade de tradução (com os endereços de wasm4.h
+ * redirecionados por w4_host.h), chama start() e depois N chamadas de update()
+ * com uma entrada de *GAMEPAD1 roteirizada e determinística. Ao final informa
+ * ns/quadro (média, p50, p99, máximo), o custo de cada etapa marcada com
+ * PROFILE_BEGIN/PROFILE_END em main.c e as chamadas importadas por quadro.
+ *
+ * Uso: bench [-n quadros] [-w aquecimento] [-s semente] [-p jogadores] [-a] [-d] [-r] [-R] [-S] [-c] [-k] [-q] [-v]
+ *   -p  quantos gamepads (1 a 4) são roteirizados, para medir a partida cooperativa
+ *   -a  o jogador 1 é o piloto automático da demonstração (autopilot_gamepad), que
+ *       joga onda após onda e recomeça ao perder: uma carga longa e realista
+ *   -d  usa o fundo denso de estrelas (STAR_COUNT_DENSE)
+ *   -r  usa o modo de retângulos sujos (framebuffer preservado)
+ *   -R  move a formação em ondulação (RIPPLE_STEPPING)
+ *   -S  só simula (simulate_frame sem os efeitos nem render_frame), para medir a simulação
+ *   -c  em vez de medir, confere que os retângulos sujos desenham o mesmo que o
+ *       redesenho completo, quadro a quadro (sai com 1 se algum quadro difere)
+ *   -k  em vez de medir, volta a cada BENCH_ROLLBACK_WINDOW quadros para o
+ *       snapshot do início da janela e re-simula, conferindo GameState e o
+ *       framebuffer de cada quadro (sai com 1 se algo diverge)
+ *   -q  em vez de medir, força cada nível de qualidade com uma carga sintética e
+ *       confere que ele entra e que a qualidade volta ao nível cheio quando a
+ *       carga some (sai com 1 se algum nível falha)
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "w4_host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// --- Etapas cronometradas ---
+
+// As etapas vêm de PROFILE_PHASES em main.c; o enum só existe após a inclusão
+#define BENCH_MAX_PHASES 16
+
+static uint64_t bench_phase_start[BENCH_MAX_PHASES];
+static uint64_t bench_phase_frame[BENCH_MAX_PHASES]; // Tempo acumulado no quadro atual
+
+static uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+#define PROFILE_BEGIN(phase) (bench_phase_start[phase] = bench_now_ns())
+#define PROFILE_END(phase) (bench_phase_frame[phase] += bench_now_ns() - bench_phase_start[phase])
+
+#include "../src/main.c"
+
+_Static_assert(PHASE_COUNT <= BENCH_MAX_PHASES, "aumente BENCH_MAX_PHASES");
+
+#define BENCH_PHASE_NAME(id, name) name,
+static const char *bench_phase_names[PHASE_COUNT] = {PROFILE_PHASES(BENCH_PHASE_NAME)};
+
+// --- Entrada roteirizada ---
+
+// Um roteiro independente por gamepad
+static uint32_t bench_script_state[MAX_PLAYERS];
+static uint8_t bench_script_direction[MAX_PLAYERS];
+static int bench_script_hold[MAX_PLAYERS];
+
+static uint32_t bench_script_next(int p)
+{
+    // xorshift32, independente de random_seed do jogo
+    bench_script_state[p] ^= bench_script_state[p] << 13;
+    bench_script_state[p] ^= bench_script_state[p] >> 17;
+    bench_script_state[p] ^= bench_script_state[p] << 5;
+    return bench_script_state[p];
+}
+
+/**
+ * Simula o jogador p: mantém uma direção por 8 a 40 quadros e segura o tiro na
+ * maior parte do tempo (o que também reinicia a partida quando volta ao menu).
+ */
+static uint8_t bench_script_gamepad(int p)
+{
+    if (bench_script_hold[p]-- <= 0)
+    {
+        static const uint8_t directions[] = {0, BUTTON_LEFT, BUTTON_RIGHT, BUTTON_LEFT, BUTTON_RIGHT};
+        bench_script_direction[p] = directions[bench_script_next(p) % sizeof(directions)];
+        bench_script_hold[p] = 8 + (int)(bench_script_next(p) % 33);
+    }
+    uint8_t buttons = bench_script_direction[p];
+    if (bench_script_next(p) % 4 != 0)
+        buttons |= BUTTON_1;
+    return buttons;
+}
+
+// Escreve nos gamepads a entrada roteirizada de um quadro
+static void bench_script_frame(unsigned long players, int autopilot)
+{
+    for (unsigned long p = 0; p < players; ++p)
+        W4_GAMEPAD(p) = bench_script_gamepad((int)p);
+    // O piloto só joga; no menu, o tiro começa a próxima partida
+    if (autopilot)
+        W4_GAMEPAD(0) = game.game_state == GAME_STATE_PLAYING ? autopilot_gamepad(0) : BUTTON_1;
+}
+
+// --- Verificações ---
+
+/**
+ * -c: roda o mesmo roteiro com o redesenho completo (em um processo filho,
+ * que manda o hash de cada quadro por um pipe) e com os retângulos sujos, e
+ * compara os framebuffers quadro a quadro, estrelas incluídas.
+ */
+static int bench_check_dirty(unsigned long frames, unsigned long players, int autopilot, int ripple, int dense_stars)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        perror("bench: pipe");
+        return 1;
+    }
+    pid_t child = fork();
+    if (child < 0)
+    {
+        perror("bench: fork");
+        return 1;
+    }
+    int dirty = child != 0; // O filho desenha por completo, o pai com retângulos sujos
+    close(fds[dirty ? 1 : 0]);
+    FILE *hashes = fdopen(fds[dirty ? 0 : 1], dirty ? "rb" : "wb");
+
+    w4_host_reset();
+    start();
+    if (dense_stars)
+        set_dense_starfield(1);
+    set_dirty_rendering(dirty);
+    ripple_stepping = ripple;
+
+    unsigned long mismatches = 0, first_mismatch = 0;
+    for (unsigned long frame = 0; frame < frames; ++frame)
+    {
+        bench_script_frame(players, autopilot);
+        w4_host_begin_frame();
+        update();
+        uint32_t hash = w4_host_framebuffer_hash();
+        if (!dirty)
+        {
+            fwrite(&hash, sizeof(hash), 1, hashes);
+            continue;
+        }
+        uint32_t expected;
+        if (fread(&expected, sizeof(expected), 1, hashes) != 1)
+        {
+            fprintf(stderr, "bench: the full redraw pass stopped at frame %lu\n", frame);
+            return 1;
+        }
+        if (hash != expected && mismatches++ == 0)
+            first_mismatch = frame;
+    }
+    fclose(hashes);
+    if (!dirty)
+        exit(0);
+
+    int status;
+    waitpid(child, &status, 0);
+    printf("dirty check: %lu frames (%lu players, %d stars, %s steps), %lu differ from the full redraw", frames,
+           players, star_count, ripple ? "ripple" : "fixed", mismatches);
+    if (mismatches)
+        printf(" (first at frame %lu)", first_mismatch);
+    printf("\n");
+    return mismatches != 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+}
+
+#define BENCH_ROLLBACK_WINDOW 8 // Quadros re-simulados em cada rollback do -k
+
+// Estado fora de GameState que um quadro altera: efeitos, áudio, qualidade,
+// fundo, gravação e disco. No cartucho o rollback do WASM-4 guarda a memória
+// inteira; aqui GameState vai junto com esta lista, e os caches de desenho
+// ficam de fora de propósito (são refeitos a partir de GameState).
+#define BENCH_PRESENTATION(X)                                                                               \
+    X(explosions) X(explosion_active) X(explosion_free) X(explosion_count) X(explosion_free_count)        \
+    X(event_ring) X(event_head) X(event_tail) X(seq_channels) X(seq_active) X(cosmetic_seed)              \
+    X(jitter_table) X(quality_level) X(quality_strain) X(quality_calm) X(quality_frame) X(star_scroll)    \
+    X(stars_drawn) X(replay_mode) X(replay_cursor) X(replay_input) X(replay_run) X(attract_idle)          \
+    X(save_delay) X(disk)
+
+#define BENCH_SNAPSHOT_FIELD(name) __typeof__(name) name;
+typedef struct
+{
+    GameState game;
+    BENCH_PRESENTATION(BENCH_SNAPSHOT_FIELD)
+} BenchSnapshot;
+
+static void bench_snapshot_save(BenchSnapshot *snapshot)
+{
+    snapshot->game = game;
+#define BENCH_SNAPSHOT_SAVE(name) memcpy(&snapshot->name, &name, sizeof(name));
+    BENCH_PRESENTATION(BENCH_SNAPSHOT_SAVE)
+}
+
+// Restaura o snapshot e descarta os caches de desenho, como um rollback só do estado
+static void bench_snapshot_load(const BenchSnapshot *snapshot)
+{
+    game = snapshot->game;
+#define BENCH_SNAPSHOT_LOAD(name) memcpy(&name, &snapshot->name, sizeof(name));
+    BENCH_PRESENTATION(BENCH_SNAPSHOT_LOAD)
+    formation_dirty_rows = (1u << ALIEN_ROWS) - 1;
+    hud_score.value = hud_wave.value = -1;
+    hud_best.value = hud_intro.value = -1;
+}
+
+// O corpo de update() para uma entrada já lida: simulação, efeitos, qualidade e desenho
+static uint32_t bench_rollback_frame(uint32_t input)
+{
+    w4_host_begin_frame();
+    simulate_frame(input);
+    update_effects();
+    update_quality();
+    render_frame();
+    return w4_host_framebuffer_hash();
+}
+
+/**
+ * -k: joga o roteiro e, no fim de cada janela de BENCH_ROLLBACK_WINDOW
+ * quadros, volta ao snapshot do começo dela e re-simula com as mesmas
+ * entradas. GameState no fim e o framebuffer de cada quadro têm de bater com
+ * os da primeira passada; depois o estado do fim da janela é restaurado e o
+ * roteiro continua. Usa sempre o redesenho completo, que não depende do
+ * framebuffer anterior.
+ */
+static int bench_check_rollback(unsigned long frames, unsigned long players, int autopilot, int ripple)
+{
+    static BenchSnapshot window_start, window_end;
+    uint32_t inputs[BENCH_ROLLBACK_WINDOW], hashes[BENCH_ROLLBACK_WINDOW];
+    unsigned long rollbacks = 0, state_mismatches = 0, frame_mismatches = 0;
+
+    w4_host_reset();
+    start();
+    set_dirty_rendering(0);
+    ripple_stepping = ripple;
+
+    for (unsigned long frame = 0; frame < frames; ++frame)
+    {
+        int i = (int)(frame % BENCH_ROLLBACK_WINDOW);
+        if (i == 0)
+            bench_snapshot_save(&window_start);
+        bench_script_frame(players, autopilot);
+        inputs[i] = read_frame_input();
+        hashes[i] = bench_rollback_frame(inputs[i]);
+        save_tick();
+        if (i < BENCH_ROLLBACK_WINDOW - 1 && frame + 1 < frames)
+            continue;
+
+        bench_snapshot_save(&window_end);
+        bench_snapshot_load(&window_start);
+        for (int j = 0; j <= i; ++j)
+            frame_mismatches += bench_rollback_frame(inputs[j]) != hashes[j];
+        state_mismatches += memcmp(&game, &window_end.game, sizeof(game)) != 0;
+        bench_snapshot_load(&window_end);
+        rollbacks++;
+    }
+
+    printf("rollback check: GameState %zu bytes, %lu rollbacks of %d frames (%lu players), "
+           "%lu states and %lu frames differ\n",
+           sizeof(GameState), rollbacks, BENCH_ROLLBACK_WINDOW, players, state_mismatches, frame_mismatches);
+    printf("final state: wave %d  score %d  framebuffer %08x\n",
+           game.current_wave, game.score, (unsigned)w4_host_framebuffer_hash());
+    return state_mismatches != 0 || frame_mismatches != 0;
+}
+
+/**
+ * Monta, sobre a partida solo com o fundo denso e a formação inteira, a menor
+ * carga de explosões e projéteis em que o nível `level - 1` passa do
+ * orçamento e `level` cabe nele. Retorna 0 se não houver uma.
+ */
+static int bench_quality_load(int level)
+{
+    for (int count = 0; count <= EXPLOSION_CAPACITY; ++count)
+    {
+        for (int projectiles = 0; projectiles <= PROJECTILE_CAPACITY; ++projectiles)
+        {
+            init_explosions();
+            for (int i = 0; i < count; ++i)
+                create_explosion(i * 3, 40);
+            clear_projectiles();
+            for (int i = 0; i < projectiles; ++i)
+                spawn_projectile(i * 2, 60, ENEMY_BULLET_SPEED, OWNER_ALIEN);
+            if (quality_cost(level - 1) > QUALITY_BUDGET && quality_cost(level) <= QUALITY_BUDGET)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * -q: para cada nível abaixo do cheio, aplica a carga de bench_quality_load e
+ * chama update_quality() quadro a quadro. O nível tem de entrar depois de
+ * QUALITY_DOWN_FRAMES quadros por degrau e não passar dele; sem a carga, a
+ * qualidade tem de voltar ao nível cheio depois de QUALITY_UP_FRAMES por
+ * degrau. A simulação não roda, então a carga não muda entre os quadros.
+ */
+static int bench_check_quality(void)
+{
+    int failures = 0;
+    w4_host_reset();
+    start();
+    set_dense_starfield(1);
+    for (int level = QUALITY_FEWER_STARS; level < QUALITY_LEVELS; ++level)
+    {
+        new_game(1, 1);
+        // A formação cheia, já fora do intervalo entre ondas, entra no custo
+        game.formation.alive = (1ull << TOTAL_ALIENS) - 1;
+        game.wave_intro = 0;
+        quality_level = QUALITY_FULL;
+        quality_strain = quality_calm = 0;
+        if (!bench_quality_load(level))
+        {
+            printf("quality level %d: no load puts it over budget\n", level);
+            failures++;
+            continue;
+        }
+        int load_cost = quality_cost(QUALITY_FULL), entered = -1, recovered = -1, highest = QUALITY_FULL;
+        for (int frame = 1; frame <= level * QUALITY_DOWN_FRAMES + 2 * QUALITY_UP_FRAMES; ++frame)
+        {
+            update_quality();
+            if (quality_level == level && entered < 0)
+                entered = frame;
+            highest = quality_level > highest ? quality_level : highest;
+        }
+
+        init_explosions();
+        clear_projectiles();
+        for (int frame = 1; frame <= level * QUALITY_UP_FRAMES && recovered < 0; ++frame)
+        {
+            update_quality();
+            if (quality_level == QUALITY_FULL)
+                recovered = frame;
+        }
+
+        int ok = entered == level * QUALITY_DOWN_FRAMES && highest == level && recovered == level * QUALITY_UP_FRAMES;
+        printf("quality level %d: load %d (budget %d), entered after %d frames, deepest %d, "
+               "full again after %d frames%s\n",
+               level, load_cost, QUALITY_BUDGET, entered, highest, recovered, ok ? "" : "  FAILED");
+        failures += !ok;
+    }
+    return failures != 0;
+}
+
+// --- Estatísticas ---
+
+static int bench_compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Retorna o percentil p (0..100) de um vetor já ordenado
+static uint64_t bench_percentile(const uint64_t *sorted, size_t count, int p)
+{
+    size_t index = (count * (size_t)p) / 100;
+    if (index >= count)
+        index = count - 1;
+    return sorted[index];
+}
+
+static void bench_report(const char *name, uint64_t *samples, size_t count, uint64_t frame_total)
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; ++i)
+        total += samples[i];
+    qsort(samples, count, sizeof(samples[0]), bench_compare_u64);
+    printf("%-24s mean %9.1f  p50 %8llu  p99 %8llu  max %9llu  share %5.1f%%\n",
+           name, (double)total / (double)count,
+           (unsigned long long)bench_percentile(samples, count, 50),
+           (unsigned long long)bench_percentile(samples, count, 99),
+           (unsigned long long)samples[count - 1],
+           frame_total ? 100.0 * (double)total / (double)frame_total : 100.0);
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [-n frames] [-w warmup] [-s seed] [-p players] [-a] [-d] [-r] [-R] [-S] [-c] [-k] [-q] [-v]\n",
+            program);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long frames = 10000, warmup = 120, seed = 1, players = 1;
+    int dense_stars = 0, dirty = 0, ripple = 0, simulate_only = 0, autopilot = 0, check_dirty = 0,
+        check_rollback = 0, check_quality = 0;
+    w4_host_quiet = 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "-v"))
+        {
+            w4_host_quiet = 0;
+        }
+        else if (!strcmp(argv[i], "-a"))
+        {
+            autopilot = 1;
+        }
+        else if (!strcmp(argv[i], "-d"))
+        {
+            dense_stars = 1;
+        }
+        else if (!strcmp(argv[i], "-r"))
+        {
+            dirty = 1;
+        }
+        else if (!strcmp(argv[i], "-R"))
+        {
+            ripple = 1;
+        }
+        else if (!strcmp(argv[i], "-S"))
+        {
+            simulate_only = 1;
+        }
+        else if (!strcmp(argv[i], "-c"))
+        {
+            check_dirty = 1;
+        }
+        else if (!strcmp(argv[i], "-k"))
+        {
+            check_rollback = 1;
+        }
+        else if (!strcmp(argv[i], "-q"))
+        {
+            check_quality = 1;
+        }
+        else if (i + 1 < argc && (!strcmp(argv[i], "-n") || !strcmp(argv[i], "-w") || !strcmp(argv[i], "-s") ||
+                                  !strcmp(argv[i], "-p")))
+        {
+            unsigned long value = strtoul(argv[i + 1], NULL, 0);
+            if (argv[i][1] == 'n')
+                frames = value;
+            else if (argv[i][1] == 'w')
+                warmup = value;
+            else if (argv[i][1] == 'p')
+                players = value;
+            else
+                seed = value;
+            ++i;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (frames == 0 || players < 1 || players > MAX_PLAYERS)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    for (unsigned long p = 0; p < players; ++p)
+        bench_script_state[p] = (uint32_t)(seed + p) ? (uint32_t)(seed + p) : 1;
+    if (check_dirty)
+        return bench_check_dirty(frames, players, autopilot, ripple, dense_stars);
+    if (check_rollback)
+        return bench_check_rollback(frames, players, autopilot, ripple);
+    if (check_quality)
+        return bench_check_quality();
+
+    uint64_t *frame_ns = calloc(frames, sizeof(uint64_t));
+    uint64_t *cost_samples = calloc(frames, sizeof(uint64_t));
+    uint64_t *phase_ns[PHASE_COUNT];
+    for (int s = 0; s < PHASE_COUNT; ++s)
+        phase_ns[s] = calloc(frames, sizeof(uint64_t));
+
+    w4_host_reset();
+    start();
+    if (dense_stars)
+        set_dense_starfield(1);
+    if (dirty)
+        set_dirty_rendering(1);
+    ripple_stepping = ripple;
+
+    unsigned long quality_frames[QUALITY_LEVELS] = {0};
+    unsigned long games = 0;
+    int highest_wave = 0, peak_projectiles = 0, peak_explosions = 0;
+    size_t cost_count = 0;
+    W4HostCalls calls_before = w4_host_calls;
+    for (unsigned long frame = 0; frame < warmup + frames; ++frame)
+    {
+        if (frame == warmup)
+            calls_before = w4_host_calls;
+
+        bench_script_frame(players, autopilot);
+        int was_playing = game.game_state == GAME_STATE_PLAYING;
+        memset(bench_phase_frame, 0, sizeof(bench_phase_frame));
+        w4_host_begin_frame();
+
+        uint64_t begin = bench_now_ns();
+        if (simulate_only)
+            simulate_frame(read_frame_input());
+        else
+            update();
+        uint64_t elapsed = bench_now_ns() - begin;
+
+        // O que rodou fora de qualquer etapa (gravação, qualidade...) fica em "other"
+        uint64_t phased = 0;
+        for (int s = 0; s < PHASE_COUNT; ++s)
+            phased += bench_phase_frame[s];
+        bench_phase_frame[PHASE_OTHER] = elapsed > phased ? elapsed - phased : 0;
+
+        if (frame >= warmup)
+        {
+            frame_ns[frame - warmup] = elapsed;
+            quality_frames[quality_level]++;
+            if (game.game_state == GAME_STATE_PLAYING)
+                cost_samples[cost_count++] = (uint64_t)quality_cost(QUALITY_FULL);
+            games += was_playing && game.game_state != GAME_STATE_PLAYING;
+            highest_wave = game.current_wave > highest_wave ? game.current_wave : highest_wave;
+            peak_projectiles = game.projectile_count > peak_projectiles ? game.projectile_count : peak_projectiles;
+            peak_explosions = explosion_count > peak_explosions ? explosion_count : peak_explosions;
+            for (int s = 0; s < PHASE_COUNT; ++s)
+                phase_ns[s][frame - warmup] = bench_phase_frame[s];
+        }
+    }
+
+    uint64_t frame_total = 0;
+    for (unsigned long i = 0; i < frames; ++i)
+        frame_total += frame_ns[i];
+
+    printf("wasminvaders bench: %lu frames (warmup %lu, seed %lu, %lu players, %d stars, %s steps, %s), ns/frame\n",
+           frames, warmup, seed, players, star_count, ripple_stepping ? "ripple" : "fixed",
+           simulate_only ? "simulation only" : dirty_rendering ? "dirty rects" : "full redraw");
+    for (int s = 0; s < PHASE_COUNT; ++s)
+        bench_report(bench_phase_names[s], phase_ns[s], frames, frame_total);
+    bench_report(simulate_only ? "simulate_frame (total)" : "update (total)", frame_ns, frames, 0);
+
+    double n = (double)frames;
+    printf("imports/frame: blit %.2f  blitSub %.2f  rect %.2f  text %.2f  tone %.3f  diskw %.3f\n",
+           (double)(w4_host_calls.blit - calls_before.blit) / n,
+           (double)(w4_host_calls.blit_sub - calls_before.blit_sub) / n,
+           (double)(w4_host_calls.rect - calls_before.rect) / n,
+           (double)(w4_host_calls.text - calls_before.text) / n,
+           (double)(w4_host_calls.tone - calls_before.tone) / n,
+           (double)(w4_host_calls.diskw - calls_before.diskw) / n);
+    printf("quality levels: full %lu  fewer stars %lu  alternate explosions %lu  simple explosions %lu frames\n",
+           quality_frames[QUALITY_FULL], quality_frames[QUALITY_FEWER_STARS],
+           quality_frames[QUALITY_ALTERNATE_EXPLOSIONS], quality_frames[QUALITY_SIMPLE_EXPLOSIONS]);
+    // A estimativa de quality_cost no nível cheio, para comparar com as etapas de desenho acima
+    if (cost_count)
+    {
+        qsort(cost_samples, cost_count, sizeof(cost_samples[0]), bench_compare_u64);
+        printf("quality cost at full: p50 %llu  p90 %llu  p99 %llu  max %llu  (budget %d)\n",
+               (unsigned long long)bench_percentile(cost_samples, cost_count, 50),
+               (unsigned long long)bench_percentile(cost_samples, cost_count, 90),
+               (unsigned long long)bench_percentile(cost_samples, cost_count, 99),
+               (unsigned long long)cost_samples[cost_count - 1], QUALITY_BUDGET);
+    }
+    if (autopilot)
+        printf("autopilot: %lu games over, highest wave %d, peak projectiles %d/%d, peak explosions %d/%d\n",
+               games, highest_wave, peak_projectiles, PROJECTILE_CAPACITY, peak_explosions, EXPLOSION_CAPACITY);
+    printf("final state: wave %d  score %d  framebuffer %08x\n",
+           game.current_wave, game.score, (unsigned)w4_host_framebuffer_hash());
+
+    for (int s = 0; s < PHASE_COUNT; ++s)
+        free(phase_ns[s]);
+    free(cost_samples);
+    free(frame_ns);
+    return 0;
+}
@@ -0,0 +1,309 @@
+/**
+ * w4_host.c - Implementações nativas das funções importadas de wasm4.h.
+ *
+ * Desenha em um framebuffer 160x160 de 2bpp na memória do processo, seguindo as
+ * regras do runtime WASM-4 (DRAW_COLORS, recorte na borda da tela, flags de blit).
+ * Não há áudio nem janela: tone() apenas conta chamadas e o disco é um vetor de
+ * 1024 bytes. A fonte de text() é substituta (não é a fonte do runtime), mas
+ * escreve a mesma quantidade de pixels por caractere.
+ */
+
+#include "w4_host.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+uint8_t w4_memory[W4_MEMORY_SIZE];
+W4HostCalls w4_host_calls;
+int w4_host_quiet = 0;
+
+static uint8_t w4_disk[W4_DISK_SIZE];
+static uint32_t w4_disk_size = 0;
+
+// --- Primitivas do framebuffer ---
+
+static void draw_point(uint8_t color, int x, int y)
+{
+    int index = (y * SCREEN_SIZE + x) >> 2;
+    int shift = (x & 3) << 1;
+    FRAMEBUFFER[index] = (uint8_t)((color << shift) | (FRAMEBUFFER[index] & ~(3 << shift)));
+}
+
+static void draw_point_clipped(uint8_t draw_color, int x, int y)
+{
+    if (draw_color == 0 || x < 0 || y < 0 || x >= SCREEN_SIZE || y >= SCREEN_SIZE)
+        return;
+    draw_point((uint8_t)((draw_color - 1) & 3), x, y);
+}
+
+static void draw_hline_clipped(uint8_t draw_color, int start_x, int y, int end_x)
+{
+    if (draw_color == 0 || y < 0 || y >= SCREEN_SIZE)
+        return;
+    if (start_x < 0)
+        start_x = 0;
+    if (end_x > SCREEN_SIZE)
+        end_x = SCREEN_SIZE;
+    for (int x = start_x; x < end_x; ++x)
+        draw_point((uint8_t)((draw_color - 1) & 3), x, y);
+}
+
+static void blit_impl(const uint8_t *sprite, int dst_x, int dst_y, int width, int height,
+                      int src_x, int src_y, int stride, uint32_t flags)
+{
+    uint16_t colors = *DRAW_COLORS;
+    int bpp2 = (flags & BLIT_2BPP) != 0;
+    int flip_x = (flags & BLIT_FLIP_X) != 0;
+    int flip_y = (flags & BLIT_FLIP_Y) != 0;
+    int rotate = (flags & BLIT_ROTATE) != 0;
+
+    // Com rotação a largura e a altura na tela se invertem
+    int out_w = rotate ? height : width;
+    int out_h = rotate ? width : height;
+    if (rotate)
+        flip_x = !flip_x;
+
+    int clip_x_min = dst_x < 0 ? 0 : dst_x;
+    int clip_y_min = dst_y < 0 ? 0 : dst_y;
+    int clip_x_max = dst_x + out_w > SCREEN_SIZE ? SCREEN_SIZE : dst_x + out_w;
+    int clip_y_max = dst_y + out_h > SCREEN_SIZE ? SCREEN_SIZE : dst_y + out_h;
+
+    for (int y = clip_y_min; y < clip_y_max; ++y)
+    {
+        for (int x = clip_x_min; x < clip_x_max; ++x)
+        {
+            int tx = x - dst_x;
+            int ty = y - dst_y;
+            if (rotate)
+            {
+                int swap = tx;
+                tx = ty;
+                ty = swap;
+            }
+            if (flip_x)
+                tx = width - tx - 1;
+            if (flip_y)
+                ty = height - ty - 1;
+
+            int sx = src_x + tx;
+            int sy = src_y + ty;
+            int bit = sy * stride + sx;
+            int color_index;
+            if (bpp2)
+                color_index = (sprite[bit >> 2] >> (6 - ((bit & 3) << 1))) & 3;
+            else
+                color_index = (sprite[bit >> 3] >> (7 - (bit & 7))) & 1;
+
+            uint8_t draw_color = (uint8_t)((colors >> (color_index << 2)) & 0xf);
+            if (draw_color != 0)
+                draw_point((uint8_t)((draw_color - 1) & 3), x, y);
+        }
+    }
+}
+
+// --- Funções importadas ---
+
+void blit(const uint8_t *data, int32_t x, int32_t y, uint32_t width, uint32_t height, uint32_t flags)
+{
+    w4_host_calls.blit++;
+    blit_impl(data, x, y, (int)width, (int)height, 0, 0, (int)width, flags);
+}
+
+void blitSub(const uint8_t *data, int32_t x, int32_t y, uint32_t width, uint32_t height,
+             uint32_t srcX, uint32_t srcY, uint32_t stride, uint32_t flags)
+{
+    w4_host_calls.blit_sub++;
+    blit_impl(data, x, y, (int)width, (int)height, (int)srcX, (int)srcY, (int)stride, flags);
+}
+
+void line(int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+{
+    w4_host_calls.line++;
+    uint8_t draw_color = (uint8_t)(*DRAW_COLORS & 0xf);
+    int dx = x2 > x1 ? x2 - x1 : x1 - x2;
+    int dy = y2 > y1 ? y1 - y2 : y2 - y1;
+    int step_x = x1 < x2 ? 1 : -1;
+    int step_y = y1 < y2 ? 1 : -1;
+    int err = dx + dy;
+    for (;;)
+    {
+        draw_point_clipped(draw_color, x1, y1);
+        if (x1 == x2 && y1 == y2)
+            break;
+        int e2 = 2 * err;
+        if (e2 >= dy)
+        {
+            err += dy;
+            x1 += step_x;
+        }
+        if (e2 <= dx)
+        {
+            err += dx;
+            y1 += step_y;
+        }
+    }
+}
+
+void hline(int32_t x, int32_t y, uint32_t len)
+{
+    w4_host_calls.hline++;
+    draw_hline_clipped((uint8_t)(*DRAW_COLORS & 0xf), x, y, x + (int)len);
+}
+
+void vline(int32_t x, int32_t y, uint32_t len)
+{
+    w4_host_calls.vline++;
+    uint8_t draw_color = (uint8_t)(*DRAW_COLORS & 0xf);
+    for (int i = 0; i < (int)len; ++i)
+        draw_point_clipped(draw_color, x, y + i);
+}
+
+void oval(int32_t x, int32_t y, uint32_t width, uint32_t height)
+{
+    w4_host_calls.oval++;
+    uint8_t fill = (uint8_t)(*DRAW_COLORS & 0xf);
+    int64_t a = (int64_t)width, b = (int64_t)height;
+    if (a == 0 || b == 0)
+        return;
+    // Aproximação: preenche os pixels cujo centro cai dentro da elipse
+    for (int64_t j = 0; j < b; ++j)
+    {
+        for (int64_t i = 0; i < a; ++i)
+        {
+            int64_t px = 2 * i + 1 - a, py = 2 * j + 1 - b;
+            if (px * px * b * b + py * py * a * a <= a * a * b * b)
+                draw_point_clipped(fill, x + (int)i, y + (int)j);
+        }
+    }
+}
+
+void rect(int32_t x, int32_t y, uint32_t width, uint32_t height)
+{
+    w4_host_calls.rect++;
+    uint16_t colors = *DRAW_COLORS;
+    uint8_t fill = (uint8_t)(colors & 0xf);
+    uint8_t stroke = (uint8_t)((colors >> 4) & 0xf);
+    int w = (int)width, h = (int)height;
+
+    for (int j = 0; j < h; ++j)
+        draw_hline_clipped(fill, x, y + j, x + w);
+
+    if (stroke != 0 && w > 0 && h > 0)
+    {
+        draw_hline_clipped(stroke, x, y, x + w);
+        draw_hline_clipped(stroke, x, y + h - 1, x + w);
+        for (int j = 1; j < h - 1; ++j)
+        {
+            draw_point_clipped(stroke, x, y + j);
+            draw_point_clipped(stroke, x + w - 1, y + j);
+        }
+    }
+}
+
+void text(const char *str, int32_t x, int32_t y)
+{
+    w4_host_calls.text++;
+    uint16_t colors = *DRAW_COLORS;
+    uint8_t fg = (uint8_t)(colors & 0xf);
+    uint8_t bg = (uint8_t)((colors >> 4) & 0xf);
+    int start_x = x;
+
+    for (; *str; ++str)
+    {
+        unsigned char c = (unsigned char)*str;
+        if (c == '\n')
+        {
+            y += FONT_SIZE;
+            x = start_x;
+            continue;
+        }
+        // Glifo substituto derivado do código do caractere
+        for (int j = 0; j < FONT_SIZE; ++j)
+        {
+            uint8_t row = c == ' ' ? 0 : (uint8_t)((c << (j & 3)) ^ (c >> (j & 1)));
+            for (int i = 0; i < FONT_SIZE; ++i)
+                draw_point_clipped(((row >> (7 - i)) & 1) ? fg : bg, x + i, y + j);
+        }
+        x += FONT_SIZE;
+    }
+}
+
+void tone(uint32_t frequency, uint32_t duration, uint32_t volume, uint32_t flags)
+{
+    (void)frequency;
+    (void)duration;
+    (void)volume;
+    (void)flags;
+    w4_host_calls.tone++;
+}
+
+uint32_t diskr(void *dest, uint32_t size)
+{
+    w4_host_calls.diskr++;
+    if (size > w4_disk_size)
+        size = w4_disk_size;
+    memcpy(dest, w4_disk, size);
+    return size;
+}
+
+uint32_t diskw(const void *src, uint32_t size)
+{
+    w4_host_calls.diskw++;
+    if (size > W4_DISK_SIZE)
+        size = W4_DISK_SIZE;
+    memcpy(w4_disk, src, size);
+    w4_disk_size = size;
+    return size;
+}
+
+void trace(const char *str)
+{
+    w4_host_calls.trace++;
+    if (!w4_host_quiet)
+        fprintf(stderr, "%s\n", str);
+}
+
+void tracef(const char *fmt, ...)
+{
+    w4_host_calls.trace++;
+    if (w4_host_quiet)
+        return;
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+// --- Ciclo de vida do runtime ---
+
+void w4_host_reset(void)
+{
+    memset(w4_memory, 0, sizeof(w4_memory));
+    memset(&w4_host_calls, 0, sizeof(w4_host_calls));
+
+    // Valores iniciais definidos pelo runtime
+    PALETTE[0] = 0xe0f8cf;
+    PALETTE[1] = 0x86c06c;
+    PALETTE[2] = 0x306850;
+    PALETTE[3] = 0x071821;
+    *DRAW_COLORS = 0x1203;
+}
+
+void w4_host_begin_frame(void)
+{
+    if (!(*SYSTEM_FLAGS & SYSTEM_PRESERVE_FRAMEBUFFER))
+        memset(FRAMEBUFFER, 0, W4_FRAMEBUFFER_SIZE);
+}
+
+uint32_t w4_host_framebuffer_hash(void)
+{
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < W4_FRAMEBUFFER_SIZE; ++i)
+    {
+        hash ^= FRAMEBUFFER[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
@@ -0,0 +1,70 @@
+/**
+ * w4_host.h - Ambiente WASM-4 simulado para compilação nativa (sem runtime w4).
+ *
+ * Reaproveita as declarações de wasm4.h, mas redireciona os endereços fixos de
+ * memória (PALETTE, DRAW_COLORS, GAMEPAD1, FRAMEBUFFER, ...) para um vetor de
+ * 64 KB no processo hospedeiro, já que no nativo o endereço 0x16 não é válido.
+ *
+ * Deve ser incluído ANTES de main.c: como wasm4.h usa #pragma once, a inclusão
+ * feita por main.c é ignorada e as macros redefinidas aqui prevalecem.
+ */
+
+#pragma once
+
+#include "../src/wasm4.h"
+
+// Memória linear simulada (mesmo tamanho da memória do cartucho)
+#define W4_MEMORY_SIZE 65536
+#define W4_DISK_SIZE 1024
+extern uint8_t w4_memory[W4_MEMORY_SIZE];
+
+#undef PALETTE
+#undef DRAW_COLORS
+#undef GAMEPAD1
+#undef GAMEPAD2
+#undef GAMEPAD3
+#undef GAMEPAD4
+#undef MOUSE_X
+#undef MOUSE_Y
+#undef MOUSE_BUTTONS
+#undef SYSTEM_FLAGS
+#undef NETPLAY
+#undef FRAMEBUFFER
+
+#define PALETTE ((uint32_t *)(w4_memory + 0x04))
+#define DRAW_COLORS ((uint16_t *)(w4_memory + 0x14))
+#define GAMEPAD1 ((const uint8_t *)(w4_memory + 0x16))
+#define GAMEPAD2 ((const uint8_t *)(w4_memory + 0x17))
+#define GAMEPAD3 ((const uint8_t *)(w4_memory + 0x18))
+#define GAMEPAD4 ((const uint8_t *)(w4_memory + 0x19))
+#define MOUSE_X ((const int16_t *)(w4_memory + 0x1a))
+#define MOUSE_Y ((const int16_t *)(w4_memory + 0x1c))
+#define MOUSE_BUTTONS ((const uint8_t *)(w4_memory + 0x1e))
+#define SYSTEM_FLAGS ((uint8_t *)(w4_memory + 0x1f))
+#define NETPLAY ((const uint8_t *)(w4_memory + 0x20))
+#define FRAMEBUFFER ((uint8_t *)(w4_memory + 0xa0))
+
+// Registradores de entrada graváveis pelo harness (os do jogo são const)
+#define W4_GAMEPAD(n) (w4_memory[0x16 + (n)])
+#define W4_MOUSE_BUTTONS (w4_memory[0x1e])
+#define W4_NETPLAY (w4_memory[0x20])
+
+#define W4_FRAMEBUFFER_SIZE (SCREEN_SIZE * SCREEN_SIZE / 4)
+
+// Contadores de chamadas às funções importadas (travessias JS/WASM no runtime real)
+typedef struct
+{
+    uint64_t blit, blit_sub, line, hline, vline, oval, rect, text, tone, diskr, diskw, trace;
+} W4HostCalls;
+
+extern W4HostCalls w4_host_calls;
+extern int w4_host_quiet; // Suprime trace/tracef quando diferente de zero
+
+// Inicializa memória, disco e contadores como o runtime faz antes de start()
+void w4_host_reset(void);
+
+// Executa o que o runtime faz antes de cada update() (limpa a tela se necessário)
+void w4_host_begin_frame(void);
+
+// Hash FNV-1a do framebuffer, usado para comparar execuções determinísticas
+uint32_t w4_host_framebuffer_hash(void);
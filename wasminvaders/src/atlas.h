@@ -0,0 +1,86 @@
+// Gerado por tools/png2atlas.c a partir de assets/atlas.txt. Não edite: rode `make atlas`.
+
+#pragma once
+
+#define ATLAS_WIDTH 64
+#define ATLAS_HEIGHT 28
+#define ATLAS_FLAGS BLIT_2BPP
+
+#define ATLAS_PLAYER_X 0
+#define ATLAS_PLAYER_Y 0
+#define ATLAS_PLAYER_WIDTH 8
+#define ATLAS_PLAYER_HEIGHT 8
+#define ATLAS_PLAYER_FRAMES 1
+
+#define ATLAS_BULLET_X 8
+#define ATLAS_BULLET_Y 0
+#define ATLAS_BULLET_WIDTH 2
+#define ATLAS_BULLET_HEIGHT 4
+#define ATLAS_BULLET_FRAMES 1
+
+#define ATLAS_ENEMY_BULLET_X 12
+#define ATLAS_ENEMY_BULLET_Y 0
+#define ATLAS_ENEMY_BULLET_WIDTH 2
+#define ATLAS_ENEMY_BULLET_HEIGHT 4
+#define ATLAS_ENEMY_BULLET_FRAMES 1
+
+#define ATLAS_ALIEN_X 16
+#define ATLAS_ALIEN_Y 0
+#define ATLAS_ALIEN_WIDTH 8
+#define ATLAS_ALIEN_HEIGHT 8
+#define ATLAS_ALIEN_FRAMES 6
+
+#define ATLAS_EXPLOSION_X 0
+#define ATLAS_EXPLOSION_Y 8
+#define ATLAS_EXPLOSION_WIDTH 8
+#define ATLAS_EXPLOSION_HEIGHT 8
+#define ATLAS_EXPLOSION_FRAMES 4
+
+#define ATLAS_DIGITS_X 0
+#define ATLAS_DIGITS_Y 16
+#define ATLAS_DIGITS_WIDTH 4
+#define ATLAS_DIGITS_HEIGHT 6
+#define ATLAS_DIGITS_FRAMES 10
+
+#define ATLAS_SCORE_LABEL_X 40
+#define ATLAS_SCORE_LABEL_Y 16
+#define ATLAS_SCORE_LABEL_WIDTH 24
+#define ATLAS_SCORE_LABEL_HEIGHT 6
+#define ATLAS_SCORE_LABEL_FRAMES 1
+
+#define ATLAS_WAVE_LABEL_X 0
+#define ATLAS_WAVE_LABEL_Y 22
+#define ATLAS_WAVE_LABEL_WIDTH 20
+#define ATLAS_WAVE_LABEL_HEIGHT 6
+#define ATLAS_WAVE_LABEL_FRAMES 1
+
+const uint8_t atlas[448] = {
+    0x02, 0x80, 0xf0, 0x80, 0x0f, 0xf0, 0x0f, 0xf0, 0x30, 0x0c, 0x30, 0x0c, 0x02, 0x80, 0x02, 0x80,
+    0x02, 0x80, 0xf0, 0x20, 0x3f, 0xfc, 0x3f, 0xfc, 0x0c, 0x30, 0xcc, 0x33, 0x0a, 0xa0, 0x0a, 0xa0,
+    0x02, 0x80, 0xf0, 0x80, 0xf3, 0xcf, 0xf3, 0xcf, 0x3f, 0xfc, 0xff, 0xff, 0x2a, 0xa8, 0x2a, 0xa8,
+    0x0a, 0xa0, 0xf0, 0x20, 0xff, 0xff, 0xff, 0xff, 0xfb, 0xef, 0xfb, 0xef, 0xae, 0xba, 0xae, 0xba,
+    0x2a, 0xa8, 0x00, 0x00, 0x3f, 0xfc, 0x3f, 0xfc, 0xff, 0xff, 0x3f, 0xfc, 0xaa, 0xaa, 0xaa, 0xaa,
+    0x2a, 0xa8, 0x00, 0x00, 0x0c, 0x30, 0x33, 0xcc, 0xcf, 0xf3, 0x0c, 0x30, 0x22, 0x88, 0x08, 0x20,
+    0x28, 0x28, 0x00, 0x00, 0x30, 0x0c, 0xc0, 0x03, 0xcc, 0x33, 0x30, 0x0c, 0x80, 0x02, 0x22, 0x88,
+    0x20, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x30, 0x0c, 0xc0, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x0c, 0x30, 0xc2, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x03, 0x00, 0x32, 0x80, 0x08, 0xe0, 0x08, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x0e, 0xc0, 0x0b, 0xec, 0x23, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x02, 0xb0, 0x3b, 0xe0, 0x08, 0x38, 0x20, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0xc0, 0x02, 0x8c, 0x32, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x0c, 0x30, 0xc0, 0x03, 0x08, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x30, 0xc0, 0xc0, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xfc, 0x30, 0xfc, 0xfc, 0xcc, 0xfc, 0xfc, 0xfc, 0xfc, 0xfc, 0xfc, 0xfc, 0xfc, 0xf0, 0xfc, 0x00,
+    0xcc, 0xf0, 0x0c, 0x0c, 0xcc, 0xc0, 0xc0, 0x0c, 0xcc, 0xcc, 0xc0, 0xc0, 0xcc, 0xcc, 0xc0, 0x30,
+    0xcc, 0x30, 0xfc, 0x3c, 0xfc, 0xfc, 0xfc, 0x30, 0xfc, 0xfc, 0xfc, 0xc0, 0xcc, 0xf0, 0xf0, 0x00,
+    0xcc, 0x30, 0xc0, 0x0c, 0x0c, 0x0c, 0xcc, 0x30, 0xcc, 0x0c, 0x0c, 0xc0, 0xcc, 0xcc, 0xc0, 0x30,
+    0xfc, 0xfc, 0xfc, 0xfc, 0x0c, 0xfc, 0xfc, 0x30, 0xfc, 0xfc, 0xfc, 0xfc, 0xfc, 0xcc, 0xfc, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xcc, 0x30, 0xcc, 0xfc, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xcc, 0xcc, 0xcc, 0xc0, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xcc, 0xfc, 0xcc, 0xf0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xfc, 0xcc, 0xcc, 0xc0, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xcc, 0xcc, 0x30, 0xfc, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
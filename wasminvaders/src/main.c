@@ -10,10 +10,17 @@
  * - Paleta de cores customizada.
  * - Efeitos sonoros e música de vitória de onda.
  * - Explosões e efeitos visuais.
+ * Os sprites vêm do atlas 2bpp gerado em atlas.h (`make atlas`).
  * O código é autocontido e não depende de bibliotecas C padrão como stdio ou stdbool.
  */
 
 #include "wasm4.h"
+#include "atlas.h"
+
+// Com -msimd128 (make BUILD=SPEED) os kernels de memória usam SIMD de 128 bits
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
 
 // --- Constantes para Lógica Booleana ---
 #define TRUE 1
@@ -24,11 +31,15 @@
 #define MOUSE_BUTTON_RIGHT 0b0010
 #define MOUSE_BUTTON_MIDDLE 0b0100
 
-// --- Constantes para Notas Musicais (Frequências em Hz) ---
-#define NOTE_C5 523
-#define NOTE_E5 659
-#define NOTE_G5 784
-#define NOTE_C6 1047
+// --- Constantes para Notas Musicais (números MIDI, tocados com TONE_NOTE_MODE) ---
+#define NOTE_G1 31  // ~49 Hz
+#define NOTE_DS2 39 // ~78 Hz
+#define NOTE_D3 50  // ~147 Hz
+#define NOTE_C5 72
+#define NOTE_E5 76
+#define NOTE_G5 79
+#define NOTE_B5 83  // ~988 Hz
+#define NOTE_C6 84
 #define NOTE_REST 0 // Para pausas
 
 // --- Constantes para Duração (em quadros, 60 quadros = 1 segundo) ---
@@ -36,114 +47,659 @@
 #define DURATION_QUARTER 15 // Semínima
 #define DURATION_EIGHTH 7   // Colcheia
 
+// --- Ponto Fixo ---
+// Velocidades em ponto fixo 8.8 (FIXED_ONE = um pixel por quadro): só somas,
+// deslocamentos e máscaras, sem multiplicação nem divisão por quadro
+#define FIXED_SHIFT 8
+#define FIXED_ONE (1 << FIXED_SHIFT)
+#define FIXED_FRACTION (FIXED_ONE - 1)
+#define FIXED(pixels) ((pixels) << FIXED_SHIFT)
+
+typedef int32_t fixed;
+
 // --- Constantes do Jogo ---
+#define MAX_PLAYERS 4                          // Jogadores da partida cooperativa (GAMEPAD1..4)
 #define PLAYER_SPEED 2                         // Velocidade de movimento do jogador
+#define PLAYER_SIZE 8                          // Largura e altura da nave
+#define PLAYER_START_Y 140                     // Linha em que as naves ficam
 #define BULLET_SPEED 4                         // Velocidade do projétil
+#define PROJECTILE_CAPACITY 64                 // Projéteis ao mesmo tempo (do jogador e dos alienígenas)
+#define PROJECTILE_WIDTH 2                     // Tamanho de um projétil
+#define PROJECTILE_HEIGHT 4
+#define PLAYER_BULLET_LIMIT 3                  // Projéteis de cada jogador ao mesmo tempo
+#define PLAYER_FIRE_COOLDOWN 12                // Quadros entre dois tiros de um jogador
+#define ENEMY_BULLET_SPEED 2                   // Velocidade dos projéteis dos alienígenas
+#define ENEMY_FIRE_DELAY_MIN 20                // Menor intervalo sorteado entre dois tiros (o maior vem da onda)
 #define ALIEN_COLS 8                           // Número de colunas de alienígenas
 #define ALIEN_ROWS 6                           // Número de linhas de alienígenas
 #define TOTAL_ALIENS (ALIEN_COLS * ALIEN_ROWS) // Cálculo do total de alienígenas
+#define ALIEN_SPACING 12                       // Distância entre slots vizinhos da formação
+#define ALIEN_SIZE 8                           // Largura e altura do sprite do alienígena
+#define ALIEN_ROW_MASK ((1ull << ALIEN_COLS) - 1) // Bits de uma linha na máscara de vivos
+#define ALIEN_STRIP_WIDTH (ALIEN_COLS * ALIEN_SPACING) // Largura da faixa pré-desenhada de uma linha
+#define ALIEN_STRIP_STRIDE (ALIEN_STRIP_WIDTH / 4)     // Bytes por linha de pixels da faixa (2bpp)
+#define ALIEN_START_X 20                       // Origem inicial da formação
+#define ALIEN_START_Y 20
+#define ALIEN_STEP 5                           // Deslocamento de um passo da formação, para o lado ou para baixo
+#define ALIEN_SPEED_RAMP (FIXED_ONE / 16)      // Velocidade ganha a cada onda depois do fim da tabela de ondas
+#define ALIEN_SPEED_MAX (3 * FIXED_ONE)        // Limite da velocidade horizontal da formação
+#define WAVE_INTRO_FRAMES 60                   // Duração do intervalo "WAVE N" entre duas ondas
+#define WAVE_INTRO_Y 76                        // Linha do texto do intervalo
+#define WAVE_INTRO_CHAR_SIZE 8                 // Lado de um caractere de text()
 #define STAR_COUNT 50                          // Número de estrelas no fundo
+#define RANDOM_SEED_GAMEPLAY 1                 // Semente inicial do fluxo da jogabilidade
+#define RANDOM_SEED_COSMETIC 0x9e3779b9        // Semente inicial do fluxo dos efeitos visuais
+#define JITTER_TABLE_SIZE 64                   // Bytes aleatórios gerados por quadro (potência de 2)
+#define STAR_COUNT_DENSE 320                   // Número de estrelas no modo de fundo denso
+#define STAR_LAYERS 3                          // Camadas de paralaxe do fundo (uma cor e uma velocidade cada)
+#define FRAMEBUFFER_STRIDE (SCREEN_SIZE / 4)   // Bytes por linha do framebuffer (2bpp)
+#define DISK_SIZE 1024                         // Limite do disco persistente do WASM-4
+
+// Liga por padrão o modo de retângulos sujos (make DIRTY_RENDERING=1)
+#ifndef DIRTY_RENDERING
+#define DIRTY_RENDERING FALSE
+#endif
+
+// Liga por padrão o passo em ondulação da formação (make RIPPLE_STEPPING=1)
+#ifndef RIPPLE_STEPPING
+#define RIPPLE_STEPPING FALSE
+#endif
+
+// --- Donos dos Projéteis ---
+// Os projéteis dos jogadores guardam o índice do jogador (0..MAX_PLAYERS-1)
+#define OWNER_ALIEN MAX_PLAYERS
+
+// --- Netplay ---
+// *NETPLAY: bit 2 ligado durante uma sessão online. Os bits 0-1 (jogador
+// local) não são lidos: a simulação é a mesma em todos os participantes.
+#define NETPLAY_ACTIVE 0b100
 
 // --- Estados do Jogo ---
 #define GAME_STATE_MENU 0
 #define GAME_STATE_PLAYING 1
 
-// --- Sprites e Paleta de Cores ---
-
-// Sprite do jogador (8x8 pixels)
-const uint8_t player_sprite[] = {
-    0b11100111,
-    0b11100111,
-    0b11100111,
-    0b11000011,
-    0b10000001,
-    0b10000001,
-    0b10011001,
-    0b10111101,
+// --- Entrada do Quadro ---
+// A entrada de um quadro junta os quatro gamepads, um byte por jogador
+// (GAMEPAD1 no byte 0), com o clique do mouse em um bit que o gamepad não usa.
+#define INPUT_MOUSE_LEFT 0x04 // Botão esquerdo do mouse na entrada do quadro
+#define INPUT_PLAYER(input, p) ((uint8_t)((input) >> ((p) * 8))) // Byte do jogador p
+
+// --- Gravação de Entradas ---
+// Só a entrada do jogador 1 é gravada: cada byte guarda os três botões lidos
+// durante a partida (bits 0-2) e quantos quadros seguidos eles se repetem
+// (bits 3-7). A gravação termina quando outro jogador entra na partida.
+#define REPLAY_RUN_SHIFT 3    // Posição do tamanho da sequência no byte gravado
+#define REPLAY_RUN_MAX 32     // Maior sequência em um byte (guardada como tamanho - 1)
+#define REPLAY_MAGIC 0x52     // 'R'
+#define REPLAY_VERSION 3
+#define REPLAY_IDLE 0         // Entrada vem do gamepad e não é gravada
+#define REPLAY_RECORDING 1    // Entrada vem do gamepad e é gravada
+#define REPLAY_PLAYING 2      // Entrada vem da gravação
+#define REPLAY_ATTRACT 3      // Entrada vem do piloto automático (demonstração)
+#define REPLAY_FAST_FORWARD 4 // Quadros simulados por quadro no avanço rápido
+
+// --- Demonstração (Piloto Automático) ---
+#define ATTRACT_IDLE_FRAMES 600     // Quadros sem entrada no menu antes de a demonstração começar
+#define AUTOPILOT_DANGER_FRAMES 20  // Antecedência com que o piloto desvia de um tiro alienígena
+#define AUTOPILOT_MARGIN 2          // Folga lateral do desvio, em pixels
+
+// --- Bloco de Salvamento ---
+#define SAVE_MAGIC 0x57          // 'W'
+#define SAVE_VERSION 1
+#define SAVE_HIGH_SCORES 3       // Maiores pontuações guardadas
+#define SAVE_OPTION_DENSE_STARS 0x01 // Fundo denso de estrelas ligado
+#define SAVE_DEBOUNCE_FRAMES 60  // Espera após mudar uma opção antes de gravar
+
+// --- Instrumentação por Etapa do Quadro ---
+
+// Etapas de update() medidas pelo perfilador: X(identificador, nome no relatório)
+// PHASE_OTHER fica com o que roda fora de qualquer etapa (gravação, qualidade...).
+#define PROFILE_PHASES(X)             \
+    X(PHASE_STARS, "stars")           \
+    X(PHASE_MENU, "menu")             \
+    X(PHASE_PLAYER, "player")         \
+    X(PHASE_PROJECTILES, "projectiles") \
+    X(PHASE_ALIENS, "aliens")         \
+    X(PHASE_COLLISIONS, "collisions") \
+    X(PHASE_HUD, "hud")               \
+    X(PHASE_AUDIO, "audio")           \
+    X(PHASE_EVENTS, "events")         \
+    X(PHASE_EXPLOSIONS, "explosions") \
+    X(PHASE_DIRTY, "dirty")           \
+    X(PHASE_OTHER, "other")
+
+#define PROFILE_PHASE_ENUM(id, name) id,
+enum
+{
+    PROFILE_PHASES(PROFILE_PHASE_ENUM)
+    PHASE_COUNT
 };
 
-// Sprite do alienígena (8x8 pixels)
-const uint8_t alien_sprite[] = {
-    0b11000011,
-    0b10000001,
-    0b00100100,
-    0b00000000,
-    0b10000001,
-    0b11011011,
-    0b10111101,
-    0b11111111,
-};
+/*
+ * Em builds DEBUG=1 cada etapa conta as chamadas às funções importadas
+ * (travessias da fronteira JS/WASM) e as unidades de trabalho declaradas com
+ * PROFILE_WORK, e um resumo é enviado por tracef a cada PROFILE_INTERVAL quadros.
+ * Em release as macros ficam vazias e nada disso é compilado.
+ * O harness nativo (bench/) pode definir PROFILE_BEGIN/PROFILE_END antes de
+ * incluir este arquivo para cronometrar as mesmas etapas.
+ */
+#if defined(DEBUG) && !defined(PROFILE_BEGIN)
+#define PROFILE_INTERVAL 120 // Quadros entre cada resumo no console
+
+typedef struct
+{
+    uint32_t blit, rect, text, tone; // Chamadas importadas por tipo
+    uint32_t other;                  // Demais importações (line, oval, disco...)
+    uint32_t work;                   // Unidades de trabalho (iterações dos laços)
+} ProfileCounters;
+
+ProfileCounters profile_window[PHASE_COUNT]; // Acumulado desde o último resumo
+int profile_phase = PHASE_OTHER;             // Etapa em execução
+int profile_frames = 0;                      // Quadros na janela atual
+uint32_t profile_frame_imports = 0;          // Importações no quadro atual
+uint32_t profile_peak_imports = 0;           // Maior número de importações em um quadro
+int profile_peak_aliens = 0;                 // Maior número de alienígenas vivos
+int profile_peak_explosions = 0;             // Maior número de explosões ativas
+
+#define PROFILE_BEGIN(phase) (profile_phase = (phase))
+#define PROFILE_END(phase) (profile_phase = PHASE_OTHER)
+#define PROFILE_WORK(units) (profile_window[profile_phase].work += (uint32_t)(units))
+#define PROFILE_IMPORT(kind) (profile_window[profile_phase].kind++, profile_frame_imports++)
+
+// Redireciona as importações pelos contadores (as declarações de wasm4.h já foram vistas)
+#define blit(...) (PROFILE_IMPORT(blit), blit(__VA_ARGS__))
+#define blitSub(...) (PROFILE_IMPORT(blit), blitSub(__VA_ARGS__))
+#define rect(...) (PROFILE_IMPORT(rect), rect(__VA_ARGS__))
+#define text(...) (PROFILE_IMPORT(text), text(__VA_ARGS__))
+#define tone(...) (PROFILE_IMPORT(tone), tone(__VA_ARGS__))
+#define line(...) (PROFILE_IMPORT(other), line(__VA_ARGS__))
+#define hline(...) (PROFILE_IMPORT(other), hline(__VA_ARGS__))
+#define vline(...) (PROFILE_IMPORT(other), vline(__VA_ARGS__))
+#define oval(...) (PROFILE_IMPORT(other), oval(__VA_ARGS__))
+#define diskr(...) (PROFILE_IMPORT(other), diskr(__VA_ARGS__))
+#define diskw(...) (PROFILE_IMPORT(other), diskw(__VA_ARGS__))
+
+void profile_frame_end();
+#define PROFILE_FRAME_END() profile_frame_end()
+#endif
+
+#ifndef PROFILE_BEGIN
+#define PROFILE_BEGIN(phase)
+#define PROFILE_END(phase)
+#endif
+#ifndef PROFILE_WORK
+#define PROFILE_WORK(units)
+#endif
+#ifndef PROFILE_FRAME_END
+#define PROFILE_FRAME_END()
+#endif
+
+// --- Verificação da Pilha (DEBUG) ---
+
+/*
+ * Com --stack-first a pilha fica logo depois do framebuffer, entre 0x19a0 e
+ * STACK_SIZE (o -zstack-size do Makefile), e cresce para baixo, em direção ao
+ * framebuffer: sobram 8 KB antes de ela começar a corromper a tela. Em builds
+ * DEBUG=1, start() pinta a parte livre da pilha com STACK_PAINT; update()
+ * confere o canário (os bytes mais baixos da pilha) e o perfilador informa a
+ * marca máxima, que é o byte pintado mais baixo que já foi sobrescrito.
+ * Só faz sentido no cartucho: no harness nativo a pilha é a do processo.
+ */
+#ifndef STACK_SIZE
+#define STACK_SIZE 14752 // Topo da pilha (mesmo valor de -zstack-size no Makefile)
+#endif
+
+#if defined(DEBUG) && defined(__wasm__)
+#define STACK_PAINT 0xa5       // Byte que marca a pilha ainda não usada
+#define STACK_CANARY_SIZE 16   // Bytes do fundo da pilha conferidos a cada quadro
+#define STACK_PAINT_MARGIN 256 // Bytes abaixo do quadro de start() deixados sem pintar
+
+// Fundo da pilha: o primeiro byte depois do framebuffer
+#define STACK_LOW ((uint8_t *)FRAMEBUFFER + SCREEN_SIZE * SCREEN_SIZE / 4)
+
+// Pinta a pilha livre, do fundo até um pouco abaixo do quadro atual
+void stack_paint()
+{
+    uint8_t *top = (uint8_t *)__builtin_frame_address(0) - STACK_PAINT_MARGIN;
+    for (uint8_t *p = STACK_LOW; p < top; ++p)
+        *p = STACK_PAINT;
+}
+
+// Maior profundidade já alcançada pela pilha, em bytes a partir do topo
+int stack_peak()
+{
+    uint8_t *p = STACK_LOW;
+    while (p < (uint8_t *)(uintptr_t)STACK_SIZE && *p == STACK_PAINT)
+        ++p;
+    return (int)((uint8_t *)(uintptr_t)STACK_SIZE - p);
+}
+
+// Para o cartucho se a pilha chegou ao canário, antes de a tela ser corrompida
+void stack_check()
+{
+    for (int i = 0; i < STACK_CANARY_SIZE; ++i)
+    {
+        if (STACK_LOW[i] != STACK_PAINT)
+        {
+            tracef("stack overflow: the stack reached the framebuffer (%d bytes)",
+                   STACK_SIZE - (int)(uintptr_t)STACK_LOW);
+            __builtin_trap();
+        }
+    }
+}
+
+#define STACK_PAINT_INIT() stack_paint()
+#define STACK_CHECK() stack_check()
+#else
+#define STACK_PAINT_INIT()
+#define STACK_CHECK()
+#endif
+
+// --- Sprites e Paleta de Cores ---
+
+// Todos os sprites ficam em `atlas` (atlas.h, gerado de assets/ por
+// tools/png2atlas.c). Com estas cores de desenho, o índice 0 do atlas é
+// transparente e os índices 1..3 são as cores 2..4 da paleta.
+#define ATLAS_DRAW_COLORS 0x4320
+#define ATLAS_STRIDE (ATLAS_WIDTH / 4) // Bytes por linha de pixels do atlas (2bpp)
 
 // --- Estruturas de Dados ---
 
 // Estrutura para as estrelas do fundo
+// A estrela i pertence à camada i % STAR_LAYERS e nunca muda: só a camada
+// rola (ver star_scroll), então a posição na tela sai da rolagem da camada.
 typedef struct
 {
-    int x, y;  // Posição na tela
-    int speed; // Velocidade de movimento para o efeito de paralaxe
+    uint8_t x, y; // Posição na camada
 } Star;
 
-// Estrutura para o jogador
+// Estrutura para um jogador
 typedef struct
 {
-    int x, y; // Posição na tela
+    int x, y;              // Posição na tela
+    uint8_t joined;        // Entrou na partida (ao começar ou atirando depois)
+    uint8_t alive;         // Não foi atingido nesta onda
+    uint8_t fire_cooldown; // Quadros até poder atirar de novo
+    uint8_t bullets;       // Projéteis dele ativos no pool
 } Player;
 
-// Estrutura para um projétil
+// Estrutura para a formação de alienígenas
+// Todos os alienígenas andam juntos: a posição de cada slot é a origem mais um
+// deslocamento fixo da grade, e quem está vivo fica em um bit de `alive`.
 typedef struct
 {
-    int x, y;
-    uint8_t active; // Estado do projétil (ativo ou inativo)
-} Bullet;
+    int x, y;       // Origem da formação (canto superior esquerdo do slot 0)
+    uint64_t alive; // Bit (linha * ALIEN_COLS + coluna) ligado = alienígena vivo
+    uint32_t columns;   // Bit c ligado = a coluna c tem algum alienígena vivo
+    int left, top;      // Caixa envolvente dos alienígenas vivos, em pixels
+    int right, bottom;  // (right e bottom exclusivos; caixa vazia sem vivos)
+    uint8_t frame;      // Quadro da animação (0 ou 1), alternado a cada passo
+    uint8_t travel;     // Pixels andados para o lado desde a última troca de quadro
+    fixed remainder;    // Fração de pixel ainda não andada (ver fixed_advance)
+    // Passo em ondulação (ver update_aliens_ripple): os slots vivos abaixo de
+    // ripple_cursor já deram o passo em andamento (step_dx, step_dy) e são
+    // desenhados com o outro quadro. Fora de uma varredura o passo é (0, 0).
+    int ripple_cursor;
+    int8_t step_dx, step_dy;
+} Formation;
+
+// --- Tipos de Alienígenas e Ondas ---
+// Cada tipo ocupa dois quadros vizinhos da folha `alien` do atlas
+enum
+{
+    ALIEN_OCTOPUS,
+    ALIEN_CRAB,
+    ALIEN_SQUID,
+    ALIEN_TYPE_COUNT
+};
 
-// Estrutura para um alienígena
 typedef struct
 {
-    int x, y;
-    uint8_t alive; // Estado do alienígena (vivo ou morto)
-} Alien;
+    uint8_t sprite_x; // x do quadro 0 no atlas (o quadro 1 vem logo à direita)
+    uint8_t points;   // Pontos por alienígena abatido
+} AlienType;
+
+const AlienType alien_types[ALIEN_TYPE_COUNT] = {
+    [ALIEN_OCTOPUS] = {ATLAS_ALIEN_X, 10},
+    [ALIEN_CRAB] = {ATLAS_ALIEN_X + 2 * ALIEN_SIZE, 20},
+    [ALIEN_SQUID] = {ATLAS_ALIEN_X + 4 * ALIEN_SIZE, 30}};
+
+_Static_assert(ATLAS_ALIEN_FRAMES == 2 * ALIEN_TYPE_COUNT, "a folha alien deve ter dois quadros por tipo");
+
+// Descritor de uma onda, lido uma vez quando ela começa (ver load_wave)
+typedef struct
+{
+    uint16_t row_types; // Tipo de cada linha, 2 bits por linha (linha 0 nos bits baixos)
+    uint8_t size;       // Linhas nos 4 bits altos, colunas nos 4 baixos
+    uint8_t move_delay; // Quadros por passo de ALIEN_STEP pixels (dá a velocidade da formação)
+    uint8_t fire_delay; // Maior intervalo sorteado entre dois tiros dos alienígenas
+} WaveDescriptor;
+
+#define WAVE_ROW_TYPES(r0, r1, r2, r3, r4, r5) \
+    (uint16_t)((r0) | (r1) << 2 | (r2) << 4 | (r3) << 6 | (r4) << 8 | (r5) << 10)
+#define WAVE(rows, cols, move_delay, fire_delay, row_types) \
+    {row_types, (uint8_t)((rows) << 4 | (cols)), move_delay, fire_delay}
+
+// Da primeira onda em diante; depois da última, as ondas repetem a última
+#define O ALIEN_OCTOPUS
+#define C ALIEN_CRAB
+#define S ALIEN_SQUID
+const WaveDescriptor wave_table[] = {
+    WAVE(1, 8, 20, 60, WAVE_ROW_TYPES(O, O, O, O, O, O)),
+    WAVE(1, 8, 14, 60, WAVE_ROW_TYPES(C, O, O, O, O, O)),
+    WAVE(2, 8, 11, 55, WAVE_ROW_TYPES(C, O, O, O, O, O)),
+    WAVE(2, 8, 8, 50, WAVE_ROW_TYPES(S, C, O, O, O, O)),
+    WAVE(3, 8, 5, 45, WAVE_ROW_TYPES(S, C, O, O, O, O)),
+    WAVE(3, 8, 4, 40, WAVE_ROW_TYPES(S, C, O, O, O, O)),
+    WAVE(4, 8, 4, 40, WAVE_ROW_TYPES(S, C, C, O, O, O)),
+    WAVE(4, 8, 4, 35, WAVE_ROW_TYPES(S, S, C, O, O, O)),
+    WAVE(5, 8, 4, 35, WAVE_ROW_TYPES(S, C, C, O, O, O)),
+    WAVE(5, 8, 4, 30, WAVE_ROW_TYPES(S, S, C, C, O, O)),
+    WAVE(6, 8, 4, 30, WAVE_ROW_TYPES(S, S, C, C, O, O))};
+#undef O
+#undef C
+#undef S
+#define WAVE_COUNT (int)(sizeof(wave_table) / sizeof(wave_table[0]))
+
+// Estado da simulação em um único bloco contíguo, sem ponteiros
+// Tudo o que decide os quadros seguintes da partida fica aqui, então copiar o
+// bloco é um snapshot completo (o rollback do netplay re-simula a partir dele)
+// e as mesmas entradas sempre levam ao mesmo estado. Explosões, áudio,
+// estrelas e caches de desenho ficam de fora: dependem do estado, mas nunca
+// o realimentam.
+typedef struct
+{
+    uint32_t random_seed;         // Estado do gerador da jogabilidade
+    Formation formation;          // Formação de alienígenas
+    Player players[MAX_PLAYERS];  // Jogadores, na ordem de GAMEPAD1..4
+
+    // Pool de projéteis em vetores paralelos, sempre compactado em [0, projectile_count)
+    int16_t projectile_x[PROJECTILE_CAPACITY];     // Posição na tela
+    int16_t projectile_y[PROJECTILE_CAPACITY];
+    int8_t projectile_vy[PROJECTILE_CAPACITY];     // Deslocamento vertical por quadro
+    uint8_t projectile_owner[PROJECTILE_CAPACITY]; // Índice do jogador ou OWNER_ALIEN
+    int projectile_count;                          // Projéteis ativos
+
+    int game_state;               // Estado atual do jogo
+    int score;                    // Pontuação da equipe
+    int current_wave;             // Número da onda atual
+    int aliens_left;              // Contador de alienígenas vivos
+    int current_alien_rows;       // Número de linhas de alienígenas na onda atual
+    int current_alien_cols;       // Número de colunas de alienígenas na onda atual
+    int current_alien_move_delay; // Valor para resetar o timer
+    int ripple_rate;              // Alienígenas que dão o passo por quadro no modo ondulação
+    fixed alien_speed;            // Velocidade horizontal da formação, em pixels por quadro (8.8)
+    int alien_direction;          // Direção dos alienígenas (1=direita, -1=esquerda)
+    int enemy_fire_timer;         // Quadros até o próximo tiro dos alienígenas
+    int enemy_fire_delay;         // Maior intervalo entre tiros na onda atual
+    uint8_t row_type[ALIEN_ROWS]; // Tipo de alienígena de cada linha na onda atual
+    uint8_t wave_intro;           // Quadros restantes do intervalo "WAVE N" (0 = onda em jogo)
+    uint8_t menu_previous_gamepad; // Entrada do jogador 1 no quadro anterior no menu (detecção de borda)
+} GameState;
+
+_Static_assert(ATLAS_BULLET_WIDTH == PROJECTILE_WIDTH && ATLAS_ENEMY_BULLET_HEIGHT == PROJECTILE_HEIGHT,
+               "os sprites dos projéteis do atlas devem ter o tamanho de um projétil");
+_Static_assert(TOTAL_ALIENS <= 64, "a máscara de vivos da formação tem 64 bits");
+_Static_assert(ALIEN_SPACING % 4 == 0 && ALIEN_SIZE % 4 == 0, "cada slot da faixa começa e termina em um byte (2bpp)");
 
 // Estrutura para uma explosão
 typedef struct {
     int x, y;
     int life; // Tempo de vida restante em frames
-    uint8_t active;
 } Explosion;
 
+// Cabeçalho da gravação de entradas: o estado que a partida gravada tinha
+// ao começar, para que a reprodução parta exatamente do mesmo ponto
+typedef struct
+{
+    uint8_t magic;          // REPLAY_MAGIC quando a gravação está completa
+    uint8_t version;        // REPLAY_VERSION
+    uint16_t length;        // Bytes usados em `data`
+    uint32_t frames;        // Quadros gravados
+    uint32_t gameplay_seed; // random_seed no início da partida
+    uint32_t cosmetic_seed; // cosmetic_seed no início da partida
+} ReplayHeader;
+
+// Bloco de salvamento: recordes e opções, protegido por um checksum
+typedef struct
+{
+    uint8_t magic;        // SAVE_MAGIC
+    uint8_t version;      // SAVE_VERSION
+    uint8_t options;      // Bits SAVE_OPTION_*
+    uint8_t last_wave;    // Onda alcançada na última partida (limitada a 255)
+    uint32_t high_scores[SAVE_HIGH_SCORES]; // Em ordem decrescente
+    uint32_t checksum;    // FNV-1a dos bytes anteriores
+} SaveBlock;
+
+_Static_assert(sizeof(SaveBlock) == 20, "o bloco de salvamento não deve ter preenchimento");
+
+#define REPLAY_CAPACITY (DISK_SIZE - (int)sizeof(SaveBlock) - (int)sizeof(ReplayHeader)) // Bytes de sequências que cabem no disco
+
+// Gravação de entradas, na mesma forma em que vai para o disco
+// Com ~15 quadros por sequência, os bytes do disco cobrem uns 4 minutos de jogo.
+typedef struct
+{
+    ReplayHeader header;
+    uint8_t data[REPLAY_CAPACITY];
+} Replay;
+
+// Conteúdo do disco: o bloco de salvamento seguido da gravação. Como diskw()
+// substitui o disco inteiro, as duas partes são sempre gravadas juntas.
+typedef struct
+{
+    SaveBlock save;
+    Replay replay;
+} DiskImage;
+
+_Static_assert(sizeof(DiskImage) <= DISK_SIZE, "o conteúdo precisa caber no disco");
+
+// Estrutura para um texto do HUD já formatado
+typedef struct
+{
+    int value;     // Valor que está formatado em `text`
+    char text[20]; // Rótulo + valor, terminado em '\0'
+} HudText;
+
+#define HUD_DIGITS 10 // Maior quantidade de dígitos de um número do HUD
+
+// Estrutura para um número do HUD já composto com os dígitos do atlas
+// Cada dígito tem 4 pixels de largura, ou seja, um byte por linha em 2bpp.
+typedef struct
+{
+    int value;  // Valor que está composto em `strip` (-1 = nenhum)
+    int width;  // Largura em pixels dos dígitos compostos
+    uint8_t strip[HUD_DIGITS * ATLAS_DIGITS_HEIGHT]; // Faixa 2bpp com HUD_DIGITS bytes por linha
+} HudNumber;
+
+_Static_assert(ATLAS_DIGITS_WIDTH == 4, "cada dígito do atlas deve ocupar um byte por linha");
+
 // --- Variáveis Globais ---
-Player player;                  // Estado do jogador
-Bullet player_bullet;           // Estado do projétil do jogador
-Alien aliens[TOTAL_ALIENS];     // Array de alienígenas
-Star stars[STAR_COUNT];         // Array de estrelas do fundo
-int game_state;                 // Estado atual do jogo
-
-int alien_direction = 1;        // Direção dos alienígenas (1=direita, -1=esquerda)
-int alien_timer = 20;           // Timer para controlar a velocidade de movimento dos alienígenas
-int current_alien_move_delay = 20; // Valor para resetar o timer
-int score = 0;                  // Pontuação do jogador
-uint32_t random_seed = 1;       // Semente para o gerador de números aleatórios
-int aliens_left;                // Contador de alienígenas vivos
-int current_wave = 1;           // Número da onda atual
-int current_alien_rows;         // Número de linhas de alienígenas na onda atual
-int current_alien_cols;         // Número de colunas de alienígenas na onda atual
+GameState game = {              // Estado da simulação (ver GameState)
+    .random_seed = RANDOM_SEED_GAMEPLAY,
+    .current_wave = 1,
+    .current_alien_move_delay = 20,
+    .alien_direction = 1};
+
+// Cache de desenho: cada linha da formação pré-composta em uma faixa 2bpp por
+// quadro da animação, refeita só quando um alienígena da linha morre (ou a
+// formação é recriada). Animar é só escolher a faixa de formation.frame.
+uint8_t formation_strips[2][ALIEN_ROWS][ALIEN_STRIP_STRIDE * ALIEN_SIZE];
+uint32_t formation_dirty_rows;  // Bit r ligado = faixa da linha r desatualizada
+Star stars[STAR_COUNT_DENSE];   // Array de estrelas do fundo
+int star_count = STAR_COUNT;    // Estrelas em uso (STAR_COUNT ou STAR_COUNT_DENSE)
+int star_scroll[STAR_LAYERS];   // Rolagem vertical de cada camada, em meios pixels
+HudNumber hud_score = {.value = -1}; // Dígitos em cache da pontuação
+HudNumber hud_wave = {.value = -1};  // Dígitos em cache da onda
+int dirty_rendering;            // Modo de retângulos sujos ativo (ver set_dirty_rendering)
+int ripple_stepping = RIPPLE_STEPPING; // Formação anda um alienígena por vez (ver update_aliens_ripple)
+uint8_t render_full = TRUE;     // Próximo quadro sujo limpa e redesenha a tela inteira
+DiskImage disk;                 // Cópia em memória do disco persistente
+int save_delay;                 // Quadros até gravar o disco (0 = nada pendente)
+HudText hud_best = {.value = -1};  // Texto em cache do recorde no menu
+HudText hud_intro = {.value = -1}; // Texto em cache do intervalo entre ondas
+int replay_mode = REPLAY_IDLE;  // De onde vem a entrada dos quadros
+int attract_idle;               // Quadros seguidos sem entrada no menu
+int replay_cursor;              // Próximo byte de disk.replay.data na reprodução
+uint8_t replay_input;           // Entrada da sequência atual
+int replay_run;                 // Quadros da sequência atual (acumulados ou restantes)
+uint32_t cosmetic_seed = RANDOM_SEED_COSMETIC; // Estado do gerador dos efeitos visuais
+uint8_t jitter_table[JITTER_TABLE_SIZE];       // Bytes aleatórios do quadro para os tremores
 
 #define EXPLOSION_DURATION 10 // Número de frames que a explosão permanece
-Explosion explosions [TOTAL_ALIENS]; // Supondo que no máximo todos os alienígenas explodam ao mesmo tempo
-
-// --- Variáveis Globais para música de vitória de onda ---
-int wave_jingle_melody[] = {
-    NOTE_C5, DURATION_EIGHTH,
-    NOTE_E5, DURATION_EIGHTH,
-    NOTE_G5, DURATION_QUARTER,
-    NOTE_C6, DURATION_HALF,
-    NOTE_REST, DURATION_EIGHTH};
-int wave_jingle_length = sizeof(wave_jingle_melody) / sizeof(wave_jingle_melody[0]);
-int current_jingle_note_index = 0;
-int jingle_note_timer = 0;
-int playing_wave_jingle = FALSE; // Flag para saber se o jingle está tocando
+
+// Capacidade do pool de explosões (pode ser sobrescrita com -DEXPLOSION_CAPACITY=n)
+#ifndef EXPLOSION_CAPACITY
+#define EXPLOSION_CAPACITY TOTAL_ALIENS // Supondo que no máximo todos os alienígenas explodam ao mesmo tempo
+#endif
+_Static_assert(EXPLOSION_CAPACITY <= 256, "os índices do pool de explosões são de 8 bits");
+
+// Pool de explosões: criar, expirar e percorrer custam só o que está ativo
+Explosion explosions[EXPLOSION_CAPACITY];     // Armazenamento das explosões
+uint8_t explosion_active[EXPLOSION_CAPACITY]; // Índices das explosões ativas, em ordem de criação
+uint8_t explosion_free[EXPLOSION_CAPACITY];   // Pilha de índices livres
+int explosion_count;                          // Explosões ativas
+int explosion_free_count;                     // Índices na pilha de livres
+
+// --- Qualidade Adaptativa ---
+// O WASM-4 não oferece relógio, então o custo do quadro é estimado pelo que
+// vai ser desenhado (ver quality_cost). Os pesos são os nanossegundos que
+// cada item custa no banco nativo (bench -a -p 4 -d); no WASM-4 tudo fica
+// mais lento, mas o que importa é a proporção entre eles. O orçamento fica
+// logo acima do pico da partida solo com o fundo denso (bench -a -d), então
+// só a cooperativa e as rajadas de explosões o passam. Acima dele, os
+// efeitos visuais são reduzidos em níveis; nada disso toca o estado da
+// simulação.
+#ifndef QUALITY_BUDGET
+#define QUALITY_BUDGET 4400             // Custo estimado por quadro antes de reduzir a qualidade
+#endif
+#define QUALITY_FIXED_COST 1000         // Placar, onda e aviso de onda
+#define QUALITY_PLAYER_COST 50          // Nave de um jogador vivo
+#define QUALITY_ROW_COST 380            // Linha da formação com vivos (uma ou duas chamadas)
+#define QUALITY_PROJECTILE_COST 30      // Um projétil (uma chamada)
+#define QUALITY_STAR_PAIR_COST 3        // Duas estrelas, escritas direto no framebuffer
+#define QUALITY_EXPLOSION_COST 210      // Explosão com tremor: o blit espelhado e a tabela sorteada
+#define QUALITY_SIMPLE_EXPLOSION_COST 90 // Explosão sem tremor
+#define QUALITY_DOWN_FRAMES 8           // Quadros seguidos acima do orçamento para reduzir um nível
+#define QUALITY_UP_FRAMES 120           // Quadros seguidos com folga para voltar um nível
+
+enum
+{
+    QUALITY_FULL,                 // Tudo
+    QUALITY_FEWER_STARS,          // Só metade das estrelas
+    QUALITY_ALTERNATE_EXPLOSIONS, // Cada explosão aparece em quadros alternados
+    QUALITY_SIMPLE_EXPLOSIONS,    // Explosões sem tremor nem espelhamento
+    QUALITY_LEVELS
+};
+
+int quality_level = QUALITY_FULL; // Nível atual (QUALITY_*)
+int quality_strain;               // Quadros seguidos acima do orçamento
+int quality_calm;                 // Quadros seguidos em que o nível anterior caberia com folga
+uint32_t quality_frame;           // Contador de quadros desenhados, para alternar as explosões
+int stars_drawn;                  // Estrelas desenhadas no quadro anterior (o modo sujo apaga essas)
+
+// --- Sequenciador de Áudio ---
+// Cada evento ocupa 2 bytes: a nota MIDI (NOTE_REST = pausa) e a duração em
+// quadros (1 a 63) com o nível de volume nos 2 bits altos.
+#define SEQ_CHANNELS 4         // Canais do WASM-4 (TONE_PULSE1..TONE_NOISE)
+#define SEQ_DURATION_MASK 0x3f // Duração do evento, em quadros
+#define SEQ_VOLUME_SHIFT 6     // Nível de volume 0..3 nos bits altos
+#define SEQ_VOLUME_STEP 25     // Volume = (nível + 1) * 25
+#define SEQ_LOOP 0x01          // O padrão recomeça ao terminar (música de fundo)
+#define SEQ_EVENT(note, frames, level) (note), (uint8_t)((frames) | ((level) << SEQ_VOLUME_SHIFT))
+
+// Prioridades: um padrão só toma o canal de outro com prioridade menor ou igual
+#define SEQ_PRIORITY_MUSIC 0
+#define SEQ_PRIORITY_SFX 1
+#define SEQ_PRIORITY_ALERT 2 // Fim de partida
+
+typedef struct
+{
+    const uint8_t *events; // Pares (nota, duração | volume << SEQ_VOLUME_SHIFT)
+    uint8_t length;        // Número de eventos
+    uint8_t channel;       // TONE_PULSE1, TONE_PULSE2, TONE_TRIANGLE ou TONE_NOISE
+    uint8_t priority;      // SEQ_PRIORITY_*
+    uint8_t flags;         // SEQ_LOOP
+} Pattern;
+
+#define PATTERN(events, channel, priority, flags) \
+    {events, sizeof(events) / 2, channel, priority, flags}
+
+typedef struct
+{
+    const Pattern *pattern; // Padrão em execução (válido se o bit do canal estiver em seq_active)
+    uint8_t position;       // Próximo evento
+    uint8_t timer;          // Quadros até o próximo evento
+} SeqChannel;
+
+const uint8_t wave_jingle_events[] = {
+    SEQ_EVENT(NOTE_C5, DURATION_EIGHTH, 3),
+    SEQ_EVENT(NOTE_E5, DURATION_EIGHTH, 3),
+    SEQ_EVENT(NOTE_G5, DURATION_QUARTER, 3),
+    SEQ_EVENT(NOTE_C6, DURATION_HALF, 3),
+    SEQ_EVENT(NOTE_REST, DURATION_EIGHTH, 0)};
+const uint8_t shot_events[] = {SEQ_EVENT(NOTE_B5, 10, 1)};
+const uint8_t alien_hit_events[] = {SEQ_EVENT(NOTE_D3, 15, 2)};
+const uint8_t player_hit_events[] = {SEQ_EVENT(NOTE_DS2, 20, 3)};
+const uint8_t game_over_events[] = {SEQ_EVENT(NOTE_G1, 60, 3)};
+
+const Pattern wave_jingle = PATTERN(wave_jingle_events, TONE_TRIANGLE, SEQ_PRIORITY_MUSIC, 0);
+const Pattern sfx_shot = PATTERN(shot_events, TONE_PULSE1, SEQ_PRIORITY_SFX, 0);
+const Pattern sfx_alien_hit = PATTERN(alien_hit_events, TONE_NOISE, SEQ_PRIORITY_SFX, 0);
+const Pattern sfx_player_hit = PATTERN(player_hit_events, TONE_NOISE, SEQ_PRIORITY_ALERT, 0);
+const Pattern sfx_game_over = PATTERN(game_over_events, TONE_TRIANGLE, SEQ_PRIORITY_ALERT, 0);
+
+// O áudio fica fora de GameState: é apresentação, como as explosões
+SeqChannel seq_channels[SEQ_CHANNELS];
+uint32_t seq_active; // Bit c ligado = canal c tocando
+
+// --- Eventos do Quadro ---
+// A simulação não toca sons nem cria explosões: ela registra o que aconteceu
+// em uma fila circular, e dispatch_events() a esvazia uma vez por quadro
+// exibido, com os eventos de todos os quadros simulados desde o anterior. A
+// fila é apresentação: fica fora de GameState, como os sons e as explosões.
+enum
+{
+    EVENT_SHOT,         // Um jogador atirou (subject = jogador)
+    EVENT_ALIEN_KILLED, // Um alienígena foi atingido (subject = slot)
+    EVENT_PLAYER_HIT,   // Um jogador saiu da onda (subject = jogador)
+    EVENT_WAVE_CLEARED, // A formação acabou e a próxima onda começou
+    EVENT_GAME_OVER,    // Não sobrou jogador vivo
+    EVENT_TYPES
+};
+
+typedef struct
+{
+    uint8_t type;    // EVENT_*
+    uint8_t subject; // Jogador ou slot, conforme o tipo
+    int16_t x, y;    // Onde aconteceu, para os efeitos
+} Event;
+
+// No pior quadro cada projétil dos jogadores acerta um alienígena, todos os
+// jogadores atiram e são atingidos, e a onda termina; no avanço rápido, a
+// fila junta REPLAY_FAST_FORWARD quadros assim antes de ser esvaziada
+#define EVENT_CAPACITY 128 // Potência de 2, até 256 (índices de 8 bits)
+_Static_assert(EVENT_CAPACITY >= REPLAY_FAST_FORWARD * (MAX_PLAYERS * (PLAYER_BULLET_LIMIT + 2) + 1),
+               "a fila de um quadro exibido não pode encher");
+
+Event event_ring[EVENT_CAPACITY];
+uint8_t event_head, event_tail; // Próximo a sair e próximo livre (módulo EVENT_CAPACITY)
+
+// Som de cada tipo de evento, tocado no máximo uma vez por quadro
+const Pattern *const event_sounds[EVENT_TYPES] = {&sfx_shot, &sfx_alien_hit, &sfx_player_hit, &wave_jingle,
+                                                  &sfx_game_over};
 
 // --- Funções Utilitárias / Auxiliares ---
 
+/**
+ * Desenha um quadro do atlas em (x, y). `flags` acrescenta espelhamentos ao
+ * formato do atlas; DRAW_COLORS deve estar em ATLAS_DRAW_COLORS.
+ */
+void draw_atlas(int x, int y, int width, int height, int src_x, int src_y, uint32_t flags)
+{
+    blitSub(atlas, x, y, (uint32_t)width, (uint32_t)height, (uint32_t)src_x, (uint32_t)src_y,
+            ATLAS_WIDTH, ATLAS_FLAGS | flags);
+}
+
 /**
  * Define a paleta de cores customizada do jogo.
  * As cores são definidas em formato hexadecimal RGB (0xRRGGBB).
@@ -169,14 +725,69 @@ void set_palette()
 }
 */
 
+/**
+ * Avança um fluxo de números aleatórios (xorshift32) e retorna 32 bits.
+ * O estado nunca pode ser zero.
+ */
+uint32_t random_next(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * Gera um inteiro em [min, max] a partir de um fluxo.
+ * Mapeia os 32 bits para o intervalo com multiplicação e deslocamento, sem módulo.
+ */
+int random_range(uint32_t *state, int min, int max)
+{
+    uint64_t span = (uint64_t)(uint32_t)(max - min + 1);
+    return min + (int)((random_next(state) * span) >> 32);
+}
+
 /**
  * Gera um número inteiro pseudoaleatório dentro de um intervalo.
- * Usa um Gerador Linear Congruencial (LCG) simples.
+ * Usa o fluxo da jogabilidade, que só deve ser consumido pela simulação
+ * para que replays e netplay sejam reproduzíveis.
  */
 int random_int(int min, int max)
 {
-    random_seed = (random_seed * 1103515245 + 12345) & 0x7fffffff;
-    return min + (int)(random_seed % (uint32_t)(max - min + 1));
+    return random_range(&game.random_seed, min, max);
+}
+
+/**
+ * Gera um inteiro em [min, max] no fluxo dos efeitos visuais.
+ * Estrelas e explosões usam este fluxo e nunca perturbam o da jogabilidade.
+ */
+int cosmetic_int(int min, int max)
+{
+    return random_range(&cosmetic_seed, min, max);
+}
+
+/**
+ * Preenche a tabela de tremores do quadro, 4 bytes por número gerado.
+ */
+void refresh_jitter_table()
+{
+    for (int i = 0; i < JITTER_TABLE_SIZE; i += 4)
+    {
+        uint32_t bits = random_next(&cosmetic_seed);
+        jitter_table[i] = (uint8_t)bits;
+        jitter_table[i + 1] = (uint8_t)(bits >> 8);
+        jitter_table[i + 2] = (uint8_t)(bits >> 16);
+        jitter_table[i + 3] = (uint8_t)(bits >> 24);
+    }
+}
+
+// Deslocamento em [-radius, radius] lido da posição `index` da tabela de tremores
+int jitter(int index, int radius)
+{
+    uint32_t span = (uint32_t)(2 * radius + 1);
+    return (int)((jitter_table[index & (JITTER_TABLE_SIZE - 1)] * span) >> 8) - radius;
 }
 
 /**
@@ -224,390 +835,1585 @@ int minimum(int a, int b)
     return (a < b) ? a : b;
 }
 
-// --- Funções de Inicialização ---
+// Retorna o maior valor entre dois inteiros
+int maximum(int a, int b)
+{
+    return (a > b) ? a : b;
+}
 
-/**
- * Posiciona as estrelas do fundo em locais aleatórios na tela.
- */
-void init_stars()
+// --- Kernels de Memória ---
+// Preenchimentos e composições em bytes 2bpp. Com SIMD (__wasm_simd128__) andam
+// 16 bytes por vez; sem SIMD (o build padrão, que o wasm3 roda) são laços simples.
+
+// Preenche count bytes a partir de dst com value
+void fill_bytes(uint8_t *dst, uint8_t value, int count)
 {
-    for (int i = 0; i < STAR_COUNT; ++i)
+#if defined(__wasm_simd128__)
+    v128_t fill = wasm_i8x16_splat((int8_t)value);
+    for (; count >= 16; count -= 16, dst += 16)
+        wasm_v128_store(dst, fill);
+    if (count >= 8)
     {
-        stars[i] = (Star){
-            .x = random_int(0, 159),
-            .y = random_int(0, 159),
-            .speed = random_int(1, 3),
-        };
+        wasm_v128_store64_lane(dst, fill, 0);
+        count -= 8, dst += 8;
     }
+#endif
+    for (int i = 0; i < count; ++i)
+        dst[i] = value;
 }
 
+_Static_assert(ALIEN_SIZE / 4 == 2 && ALIEN_STRIP_STRIDE == 24, "compose_strip compõe 2 bytes por slot em 16 + 8 bytes");
+
 /**
- * Posiciona os alienígenas na formação inicial.
+ * Escreve a faixa 2bpp de uma linha da formação: o quadro sprite (no atlas)
+ * em cada slot vivo de row_alive e transparente (0) no resto. Cada slot começa
+ * em um byte inteiro, então os bytes do sprite são copiados sem deslocamento.
+ * Com SIMD, um swizzle espalha os 2 bytes de cada linha do sprite pelos slots
+ * vivos e zera o resto, escrevendo a linha inteira da faixa de uma vez.
  */
-void init_aliens()
+void compose_strip(uint8_t *strip, const uint8_t *sprite, uint32_t row_alive)
 {
-    aliens_left = 0;
-
-    // Limita o número de linhas e colunas
-    if (current_alien_rows > ALIEN_ROWS)
+#if defined(__wasm_simd128__)
+    // Byte do sprite que vai em cada byte da linha da faixa (fora de 0..15 = zero)
+    uint8_t lanes[32];
+    for (int i = 0; i < ALIEN_STRIP_STRIDE; ++i)
     {
-        current_alien_rows = ALIEN_ROWS;
+        int slot = i / (ALIEN_SPACING / 4), byte = i % (ALIEN_SPACING / 4);
+        lanes[i] = (uint8_t)((byte < ALIEN_SIZE / 4 && ((row_alive >> slot) & 1)) ? byte : 0x80);
     }
-    if (current_alien_cols > ALIEN_COLS)
+    v128_t low = wasm_v128_load(lanes), high = wasm_v128_load(lanes + 16);
+    for (int y = 0; y < ALIEN_SIZE; ++y)
     {
-        current_alien_cols = ALIEN_COLS;
+        const uint8_t *line = sprite + y * ATLAS_STRIDE;
+        v128_t pixels = wasm_i16x8_splat((int16_t)(line[0] | line[1] << 8));
+        wasm_v128_store(strip + y * ALIEN_STRIP_STRIDE, wasm_i8x16_swizzle(pixels, low));
+        wasm_v128_store64_lane(strip + y * ALIEN_STRIP_STRIDE + 16, wasm_i8x16_swizzle(pixels, high), 0);
     }
-
-    // Inicializa alienígenas vivos
-    for (int y = 0; y < current_alien_rows; ++y)
+#else
+    fill_bytes(strip, 0, ALIEN_STRIP_STRIDE * ALIEN_SIZE); // Transparente
+    while (row_alive)
     {
-        for (int x = 0; x < current_alien_cols; ++x)
+        int byte = __builtin_ctz(row_alive) * (ALIEN_SPACING / 4);
+        row_alive &= row_alive - 1;
+        for (int y = 0; y < ALIEN_SIZE; ++y)
         {
-            int index = y * ALIEN_COLS + x;
-            aliens[index] = (Alien){.x = 20 + x * 12, .y = 20 + y * 12, .alive = TRUE};
-            aliens_left++;
+            for (int b = 0; b < ALIEN_SIZE / 4; ++b)
+                strip[y * ALIEN_STRIP_STRIDE + byte + b] = sprite[y * ATLAS_STRIDE + b];
         }
     }
-
-    // Marca alienígenas restantes como mortos
-    for (int i = aliens_left; i < TOTAL_ALIENS; ++i)
-    {
-        aliens[i].alive = FALSE;
-    }
+#endif
 }
 
-// Cria uma explosão na posição especificada
+// --- Funções da Formação ---
 
-void create_explosion(int x, int y) {
-    for (int i = 0; i < TOTAL_ALIENS; ++i) {
-        if (!explosions [i].active) {
-            explosions [i].x = x;
-            explosions [i].y = y;
-            explosions [i].life = EXPLOSION_DURATION;
-            explosions [i].active = TRUE;
-            break;
-        }
-    }
+// Posição na tela do alienígena no slot `index` (linha * ALIEN_COLS + coluna)
+int alien_x(int index)
+{
+    int stepped = index < game.formation.ripple_cursor;
+    return game.formation.x + (index % ALIEN_COLS) * ALIEN_SPACING + stepped * game.formation.step_dx;
 }
 
-/**
- * Função principal de inicialização do jogo.
- * É chamada uma única vez quando o cartucho é carregado.
- */
-void start()
+int alien_y(int index)
 {
-    set_palette();
-    init_stars();
-
-    current_wave = 1;
-    current_alien_rows = 1;
-    current_alien_cols = ALIEN_COLS;
-
-    init_aliens();
-
-    player.x = 76;
-    player.y = 140;
-    player_bullet.active = FALSE;
-    game_state = GAME_STATE_MENU;
-    for (int i = 0; i < TOTAL_ALIENS; ++i) {
-        explosions [i].active = FALSE;
-    }
-
-    current_alien_move_delay = 20;
-    alien_timer = current_alien_move_delay;
+    int stepped = index < game.formation.ripple_cursor;
+    return game.formation.y + (index / ALIEN_COLS) * ALIEN_SPACING + stepped * game.formation.step_dy;
 }
 
-// --- Funções de Lógica e Comportamento do Jogo ---
+// Retorna e remove o índice do próximo alienígena vivo de uma cópia da máscara
+int next_alien(uint64_t *mask)
+{
+    int index = __builtin_ctzll(*mask);
+    *mask &= *mask - 1;
+    return index;
+}
 
 /**
- * Toca a melodia de "próxima onda" nota por nota.
+ * Recalcula a caixa envolvente dos alienígenas vivos a partir da máscara.
+ * As linhas da máscara são juntadas em máscaras de colunas e de linhas ocupadas,
+ * e as bordas saem de ctz/clz. Só é preciso quando um alienígena morre ou a
+ * formação é recriada; os passos da formação apenas deslocam a caixa.
  */
-void play_wave_jingle()
+void formation_update_bounds()
 {
-    if (!playing_wave_jingle)
+    uint32_t columns = 0, rows = 0;
+    for (int row = 0; row < ALIEN_ROWS; ++row)
     {
-        return;
+        uint32_t row_alive = (uint32_t)((game.formation.alive >> (row * ALIEN_COLS)) & ALIEN_ROW_MASK);
+        columns |= row_alive;
+        rows |= (uint32_t)(row_alive != 0) << row;
     }
 
-    if (jingle_note_timer > 0)
+    game.formation.columns = columns;
+    if (!columns)
     {
-        jingle_note_timer--;
+        game.formation.left = game.formation.right = game.formation.x;
+        game.formation.top = game.formation.bottom = game.formation.y;
         return;
     }
+    game.formation.left = game.formation.x + __builtin_ctz(columns) * ALIEN_SPACING;
+    game.formation.right = game.formation.x + (31 - __builtin_clz(columns)) * ALIEN_SPACING + ALIEN_SIZE;
+    game.formation.top = game.formation.y + __builtin_ctz(rows) * ALIEN_SPACING;
+    game.formation.bottom = game.formation.y + (31 - __builtin_clz(rows)) * ALIEN_SPACING + ALIEN_SIZE;
+
+    // Durante uma varredura a caixa cobre as posições de antes e de depois do passo
+    game.formation.left += minimum(game.formation.step_dx, 0);
+    game.formation.right += maximum(game.formation.step_dx, 0);
+    game.formation.bottom += game.formation.step_dy;
+}
 
-    if (current_jingle_note_index < wave_jingle_length)
-    {
-        int frequency = wave_jingle_melody[current_jingle_note_index];
-        int duration_frames = wave_jingle_melody[current_jingle_note_index + 1];
-
-        if (frequency != NOTE_REST)
-        {
-            tone((uint32_t)frequency, (uint32_t)duration_frames, 100, TONE_TRIANGLE);
-        }
-
-        jingle_note_timer = duration_frames;
+// Desloca a formação inteira (origem e caixa envolvente)
+void formation_move(int dx, int dy)
+{
+    game.formation.x += dx;
+    game.formation.y += dy;
+    game.formation.left += dx;
+    game.formation.right += dx;
+    game.formation.top += dy;
+    game.formation.bottom += dy;
+}
 
-        current_jingle_note_index += 2;
-    }
-    else
-    {
-        playing_wave_jingle = FALSE;
-        tone(0, 0, 0, 0);
-    }
+// Remove o alienígena do slot `index` da formação
+void formation_kill(int index)
+{
+    game.formation.alive &= ~(1ull << index);
+    formation_dirty_rows |= 1u << (index / ALIEN_COLS);
+    formation_update_bounds();
 }
 
+// As faixas copiam bytes inteiros do atlas (4 pixels em 2bpp por byte)
+_Static_assert(ATLAS_ALIEN_X % 4 == 0 && ALIEN_SIZE % 4 == 0,
+               "os sprites dos alienígenas devem começar em múltiplos de 4 pixels no atlas");
+
 /**
- * Processa a entrada do jogador, move a nave e gerencia o disparo.
+ * Compõe as faixas 2bpp (uma por quadro da animação) de uma linha da formação
+ * com os alienígenas vivos, usando o sprite do tipo da linha. O índice 0 é
+ * transparente com ATLAS_DRAW_COLORS, então os slots vazios ficam zerados.
  */
-void update_player(uint8_t gamepad)
+void render_formation_row(int row)
 {
-    // Movimento horizontal
-    if (gamepad & BUTTON_LEFT)
-        player.x -= PLAYER_SPEED;
-    if (gamepad & BUTTON_RIGHT)
-        player.x += PLAYER_SPEED;
-
-    // Limita posição do jogador
-    if (player.x < 0)
-        player.x = 0;
-    if (player.x > 160 - 8)
-        player.x = 160 - 8;
-
-    // Disparo do projétil
-    if ((gamepad & BUTTON_1) && !player_bullet.active)
+    uint32_t row_alive = (uint32_t)((game.formation.alive >> (row * ALIEN_COLS)) & ALIEN_ROW_MASK);
+    for (int frame = 0; frame < 2; ++frame)
     {
-        player_bullet.x = player.x + 3;
-        player_bullet.y = player.y;
-        player_bullet.active = TRUE;
-        tone(1000, 10, 50, TONE_PULSE1); // Som de tiro
+        int sprite_x = alien_types[game.row_type[row]].sprite_x + frame * ALIEN_SIZE;
+        compose_strip(formation_strips[frame][row], atlas + ATLAS_ALIEN_Y * ATLAS_STRIDE + sprite_x / 4, row_alive);
     }
-
-    // Desenha o jogador
-    *DRAW_COLORS = 3; // Cor da nave
-    blit(player_sprite, player.x, player.y, 8, 8, BLIT_1BPP);
+    formation_dirty_rows &= ~(1u << row);
 }
 
 /**
- * Move e desenha o projétil do jogador se ele estiver ativo.
+ * Retorna o slot do alienígena vivo que colide com o retângulo (x, y, w, h), ou -1.
+ * Como os slots ficam numa grade fixa a partir da origem da formação, as bordas
+ * do retângulo viram linha/coluna e só as células cobertas são testadas (para um
+ * projétil, a célula dele e no máximo a vizinha), sem percorrer a formação.
  */
-void update_player_bullet()
+int formation_hit(int x, int y, int w, int h)
 {
-    if (player_bullet.active)
+    // No meio de uma varredura, parte dos alienígenas já saiu da sua célula pelo passo
+    int dx = game.formation.step_dx, dy = game.formation.step_dy;
+    int col_first = (x - maximum(dx, 0) - game.formation.x) / ALIEN_SPACING;
+    int col_last = (x + w - 1 - minimum(dx, 0) - game.formation.x) / ALIEN_SPACING;
+    int row_first = (y - dy - game.formation.y) / ALIEN_SPACING;
+    int row_last = (y + h - 1 - game.formation.y) / ALIEN_SPACING;
+    if (col_first < 0)
+        col_first = 0;
+    if (row_first < 0)
+        row_first = 0;
+    if (col_last >= ALIEN_COLS)
+        col_last = ALIEN_COLS - 1;
+    if (row_last >= ALIEN_ROWS)
+        row_last = ALIEN_ROWS - 1;
+
+    for (int row = row_first; row <= row_last; ++row)
     {
-        player_bullet.y -= BULLET_SPEED;
-        if (player_bullet.y < 0)
+        for (int col = col_first; col <= col_last; ++col)
         {
-            player_bullet.active = FALSE;
+            PROFILE_WORK(1);
+            int index = row * ALIEN_COLS + col;
+            if (!(game.formation.alive & (1ull << index)))
+                continue;
+            int a_x = alien_x(index), a_y = alien_y(index);
+            // A célula cobre também o espaço entre os alienígenas
+            if (x < a_x + ALIEN_SIZE && x + w > a_x && y < a_y + ALIEN_SIZE && y + h > a_y)
+                return index;
         }
-        *DRAW_COLORS = 4; // Cor do projétil
-        rect(player_bullet.x, player_bullet.y, 2, 4);
     }
+    return -1;
+}
+
+// --- Gravação e Reprodução de Entradas ---
+
+// Indica se há uma gravação completa para reproduzir
+int replay_available()
+{
+    return disk.replay.header.magic == REPLAY_MAGIC && disk.replay.header.frames > 0;
 }
 
 /**
- * Move e desenha a formação de alienígenas.
+ * Começa a gravar a partida que está iniciando. Deve ser chamada depois que o
+ * estado da partida foi reiniciado, para o cabeçalho guardar o ponto de partida.
  */
-void update_aliens()
+void replay_begin_recording()
 {
-    uint8_t move_down = FALSE;
-    alien_timer--;
-    if (alien_timer <= 0)
-    {
-        alien_timer = current_alien_move_delay;
-        // Verifica se algum alienígena chegou na borda
-        for (int i = 0; i < TOTAL_ALIENS; ++i)
-        {
-            if (aliens[i].alive)
-            {
-                if ((aliens[i].x >= 160 - 8 && alien_direction > 0) || (aliens[i].x <= 0 && alien_direction < 0))
-                {
-                    move_down = TRUE;
-                    break;
-                }
-            }
-        }
-        if (move_down)
-        {
-            alien_direction *= -1;
-            for (int i = 0; i < TOTAL_ALIENS; ++i)
-                aliens[i].y += 5;
-        }
-        else
-        {
-            for (int i = 0; i < TOTAL_ALIENS; ++i)
-                aliens[i].x += alien_direction * 5;
-        }
-    }
+    disk.replay.header = (ReplayHeader){
+        .version = REPLAY_VERSION,
+        .gameplay_seed = game.random_seed,
+        .cosmetic_seed = cosmetic_seed};
+    replay_run = 0;
+    replay_mode = REPLAY_RECORDING;
+}
 
-    // Desenha alienígenas vivos
-    *DRAW_COLORS = 4;
-    for (int i = 0; i < TOTAL_ALIENS; ++i)
-    {
-        if (aliens[i].alive)
-        {
-            blit(alien_sprite, aliens[i].x, aliens[i].y, 8, 8, BLIT_1BPP);
-        }
-    }
+// Reduz a entrada do quadro aos botões que a partida lê (3 bits)
+uint8_t replay_pack(uint8_t input)
+{
+    return (uint8_t)((input & BUTTON_1) | ((input & (BUTTON_LEFT | BUTTON_RIGHT)) >> 3));
 }
 
-/*
-    * Atualiza o estado das explosões, diminuindo sua vida e desativando-as quando necessário.
-*/
-void update_explosions() {
-    for (int i = 0; i < TOTAL_ALIENS; ++i) {
-        if (explosions [i].active) {
-            explosions [i].life--;
-            if (explosions [i].life <= 0) {
-                explosions [i].active = FALSE;
-            }
-        }
-    }
+// Reconstrói a entrada do quadro a partir dos 3 bits gravados
+uint8_t replay_unpack(uint8_t bits)
+{
+    return (uint8_t)((bits & BUTTON_1) | ((bits << 3) & (BUTTON_LEFT | BUTTON_RIGHT)));
+}
+
+// Escreve a sequência pendente em disk.replay.data; retorna FALSE se não couber
+int replay_flush_run()
+{
+    ReplayHeader *header = &disk.replay.header;
+    if (header->length >= REPLAY_CAPACITY)
+        return FALSE;
+
+    disk.replay.data[header->length++] = (uint8_t)(replay_input | ((replay_run - 1) << REPLAY_RUN_SHIFT));
+    header->frames += (uint32_t)replay_run;
+    replay_run = 0;
+    return TRUE;
 }
 
 /**
- * Verifica colisões entre o projétil do jogador e os alienígenas.
+ * Encerra a gravação, que vai para o disco com o resultado da partida.
+ * Chamada quando a partida termina ou quando a gravação enche.
  */
-void check_collisions()
+void replay_finish_recording()
 {
-    if (!player_bullet.active)
-        return;
-    for (int i = 0; i < TOTAL_ALIENS; ++i)
+    if (replay_run > 0)
+        replay_flush_run();
+    disk.replay.header.magic = REPLAY_MAGIC;
+    replay_mode = REPLAY_IDLE;
+}
+
+// Acrescenta a entrada de um quadro à gravação
+void replay_record(uint8_t input)
+{
+    input = replay_pack(input);
+    if (replay_run > 0 && (input != replay_input || replay_run == REPLAY_RUN_MAX))
     {
-        if (aliens[i].alive)
+        if (!replay_flush_run())
         {
-            int a_x = aliens[i].x, a_y = aliens[i].y, a_w = 8, a_h = 8;
-            int b_x = player_bullet.x, b_y = player_bullet.y, b_w = 2, b_h = 4;
-            // Verifica colisão
-            if (b_x < a_x + a_w && b_x + b_w > a_x && b_y < a_y + a_h && b_y + b_h > a_y)
-            {
-                aliens[i].alive = FALSE;
-                create_explosion(aliens [i].x, aliens [i].y);
-                player_bullet.active = FALSE;
-                score += 10;
-                aliens_left--;
-                tone(150, 15, 80, TONE_NOISE);
-                break;
-            }
+            // Disco cheio: o que já foi gravado continua reproduzível
+            replay_finish_recording();
+            return;
         }
     }
+    replay_input = input;
+    replay_run++;
 }
 
 /**
- * Prepara a próxima onda de alienígenas, aumentando a dificuldade.
+ * Prepara a reprodução da gravação: restaura o estado inicial que não é
+ * reiniciado por new_game(). A partida deve ser iniciada em seguida com
+ * new_game(disk.replay.header.gameplay_seed, 1), só com o jogador 1.
  */
-void next_wave()
+void replay_begin_playback()
 {
-    current_wave++;
+    cosmetic_seed = disk.replay.header.cosmetic_seed;
+    replay_cursor = 0;
+    replay_run = 0;
+    replay_mode = REPLAY_PLAYING;
+}
 
-    // Aumenta velocidade dos alienígenas
-    current_alien_move_delay = 20 - (current_wave * 3);
-    if (current_alien_move_delay < 5)
+// Retorna a entrada do próximo quadro gravado, ou -1 quando a gravação acabou
+int replay_next_input()
+{
+    if (replay_run == 0)
     {
-        current_alien_move_delay = 4;
+        if (replay_cursor >= disk.replay.header.length)
+            return -1;
+        uint8_t entry = disk.replay.data[replay_cursor++];
+        replay_input = replay_unpack(entry);
+        replay_run = (entry >> REPLAY_RUN_SHIFT) + 1;
     }
-    alien_timer = current_alien_move_delay;
+    replay_run--;
+    return replay_input;
+}
 
-    current_alien_cols = ALIEN_COLS;
-    current_alien_rows = (current_wave + 1) / 2;
-    if (current_alien_rows > ALIEN_ROWS)
-    {
-        current_alien_rows = ALIEN_ROWS;
-    }
+/**
+ * Indica se o jogo está em uma sessão de netplay. Nela só os gamepads são
+ * sincronizados entre os participantes: o mouse e o disco são de cada um e
+ * não podem influenciar a simulação.
+ */
+int netplay_active()
+{
+    return (*NETPLAY & NETPLAY_ACTIVE) != 0;
+}
 
-    init_aliens();
-    alien_direction = 1;
+// --- Piloto Automático ---
 
-    // Inicia jingle de vitória
-    current_jingle_note_index = 0;
-    jingle_note_timer = 0;
-    playing_wave_jingle = TRUE;
+/**
+ * Velocidade horizontal média da formação, em pixels por quadro (8.8). Em
+ * ondulação, cada varredura de ALIEN_STEP pixels leva um quadro por grupo de
+ * ripple_rate alienígenas vivos, então a formação acelera conforme eles morrem.
+ */
+fixed formation_speed()
+{
+    if (!ripple_stepping)
+        return game.alien_speed;
+    int sweep = maximum((game.aliens_left + game.ripple_rate - 1) / game.ripple_rate, 1);
+    return FIXED(ALIEN_STEP) / sweep;
 }
 
 /**
- * Verifica colisões entre os alienígenas e o jogador.
- * Se houver colisão, define o estado do jogo para GAME_STATE_MENU.
+ * Onde o alienígena do slot estará daqui a `frames` quadros. A formação vai e
+ * volta entre as bordas da tela e, em cada borda, para o tempo de uma descida
+ * (um quadro, ou uma varredura em ondulação): o caminho é uma volta de
+ * 2 * (span + pause) pixels, percorrida a formation_speed().
  */
-void check_player_collision()
+int predict_alien_x(int slot, int frames)
 {
-    int p_x = player.x, p_y = player.y, p_w = 8, p_h = 8;
-
-    for (int i = 0; i < TOTAL_ALIENS; ++i)
+    // Limites da caixa da formação nas bordas. Em ondulação ela anda em passos
+    // de ALIEN_STEP e só vira no primeiro passo que alcança a borda.
+    int left = game.formation.left, right = game.formation.right, left_end = 0, right_end = SCREEN_SIZE;
+    if (ripple_stepping)
     {
-        if (aliens[i].alive)
-        {
-            int a_x = aliens[i].x, a_y = aliens[i].y, a_w = 8, a_h = 8;
-
-            // Verifica colisão
-            if (p_x < a_x + a_w &&
-                p_x + p_w > a_x &&
-                p_y < a_y + a_h &&
-                p_y + p_h > a_y)
-            {
-                game_state = GAME_STATE_MENU;
-
-                tone(50, 60, 100, TONE_TRIANGLE);
-
-                // Reinicia estado do jogo
-                init_aliens();
-                player.x = 76;
-                player_bullet.active = FALSE;
-                score = 0;
-                alien_timer = 20;
-                alien_direction = 1;
-                current_wave = 1;
-                current_alien_rows = 3;
-                current_alien_cols = ALIEN_COLS;
-
-                return;
-            }
-        }
+        int over_left = (left % ALIEN_STEP + ALIEN_STEP) % ALIEN_STEP;
+        int over_right = ((SCREEN_SIZE - right) % ALIEN_STEP + ALIEN_STEP) % ALIEN_STEP;
+        left_end = over_left ? over_left - ALIEN_STEP : 0;
+        right_end = over_right ? SCREEN_SIZE + ALIEN_STEP - over_right : SCREEN_SIZE;
     }
+    int x = alien_x(slot);
+    int low = x - (left - left_end), span = right_end - left_end - (right - left);
+    if (span <= 0)
+        return x;
+    fixed speed = formation_speed();
+    int pause = ripple_stepping ? ALIEN_STEP : maximum(speed >> FIXED_SHIFT, 1);
+    int lap = 2 * (span + pause);
+    int travel = game.alien_direction > 0 ? x - low : lap - pause - (x - low);
+    travel = (travel + ((speed * frames) >> FIXED_SHIFT)) % lap;
+    if (travel < span)
+        return low + travel;
+    if (travel < span + pause)
+        return low + span;
+    if (travel < 2 * span + pause)
+        return low + span - (travel - span - pause);
+    return low;
 }
 
-// --- Funções de Desenho e UI (Interface do Usuário) ---
-
 /**
- * Desenha o fundo animado de estrelas.
- * As estrelas se movem para baixo, criando um efeito de paralaxe.
+ * Escolhe os botões do jogador p só a partir do estado da simulação. Desvia
+ * do tiro alienígena mais próximo que vai passar pela nave; sem ameaça, segue
+ * o alienígena vivo da linha mais baixa da formação mais perto dele, mirando
+ * onde ele estará quando o projétil chegar, e atira quando está alinhado.
+ * Usado pela demonstração do menu e pelo harness nativo.
  */
-void draw_background_stars()
+uint8_t autopilot_gamepad(int p)
 {
-    for (int i = 0; i < STAR_COUNT; ++i)
+    const Player *player = &game.players[p];
+    if (!player->alive)
+        return 0;
+
+    // Ameaça: o tiro alienígena que chega primeiro à faixa da nave
+    int threat_x = -1, threat_frames = AUTOPILOT_DANGER_FRAMES;
+    for (int i = 0; i < game.projectile_count; ++i)
+    {
+        int x = game.projectile_x[i];
+        if (game.projectile_owner[i] != OWNER_ALIEN || x + PROJECTILE_WIDTH + AUTOPILOT_MARGIN <= player->x ||
+            x >= player->x + PLAYER_SIZE + AUTOPILOT_MARGIN)
+            continue;
+        int distance = player->y - (game.projectile_y[i] + PROJECTILE_HEIGHT);
+        if (distance < -PLAYER_SIZE - PROJECTILE_HEIGHT)
+            continue; // Já passou
+        int frames = distance / game.projectile_vy[i];
+        if (frames < threat_frames)
+            threat_x = x, threat_frames = frames;
+    }
+    if (threat_x >= 0)
     {
-        stars[i].y += minimum(stars[i].speed, 2);
+        // Sai pelo lado que pede menos pixels e cabe na tela
+        int left = player->x + PLAYER_SIZE + AUTOPILOT_MARGIN - threat_x;
+        int right = threat_x + PROJECTILE_WIDTH + AUTOPILOT_MARGIN - player->x;
+        if (player->x - left < 0)
+            return BUTTON_RIGHT;
+        if (player->x + right > SCREEN_SIZE - PLAYER_SIZE)
+            return BUTTON_LEFT;
+        return left <= right ? BUTTON_LEFT : BUTTON_RIGHT;
+    }
 
-        if (stars[i].y > 160)
+    // Alvo: na linha viva mais baixa, o alienígena mais perto da nave
+    int target = -1;
+    for (int row = ALIEN_ROWS - 1; row >= 0 && target < 0; --row)
+    {
+        uint32_t row_alive = (uint32_t)((game.formation.alive >> (row * ALIEN_COLS)) & ALIEN_ROW_MASK);
+        for (int best = SCREEN_SIZE * 2; row_alive; row_alive &= row_alive - 1)
         {
-            stars[i].y = 0;
-            stars[i].x = random_int(0, 159);
+            int slot = row * ALIEN_COLS + __builtin_ctz(row_alive);
+            int distance = alien_x(slot) - player->x;
+            distance = distance < 0 ? -distance : distance;
+            if (distance < best)
+                target = slot, best = distance;
         }
+    }
+    if (target < 0)
+        return 0;
+
+    // O projétil sai em player->x + 3 e sobe BULLET_SPEED pixels por quadro
+    int flight = (player->y - alien_y(target) - ALIEN_SIZE / 2) / BULLET_SPEED;
+    int aim = predict_alien_x(target, flight) + ALIEN_SIZE / 2 - 3 - PROJECTILE_WIDTH / 2;
+    uint8_t buttons = 0;
 
-        // Define a cor da estrela com base na sua velocidade para dar profundidade
-        *DRAW_COLORS = (uint16_t)(stars[i].speed + 1);
-        rect(stars[i].x, stars[i].y, 1, 1); // Desenha a estrela como um pixel
+    // Um alvo mais rápido que a nave não dá para seguir: ela espera ele passar
+    if (formation_speed() <= FIXED(PLAYER_SPEED))
+    {
+        if (aim < player->x - 1)
+            buttons |= BUTTON_LEFT;
+        else if (aim > player->x + 1)
+            buttons |= BUTTON_RIGHT;
     }
+    if (aim - player->x >= -ALIEN_SIZE / 2 && aim - player->x < ALIEN_SIZE / 2)
+        buttons |= BUTTON_1;
+    return buttons;
 }
 
-/**
- * Desenha as explosões na tela.
- * As explosões são desenhadas como pequenos quadrados.
- */
-void draw_explosions() {
-    for (int i = 0; i < TOTAL_ALIENS; ++i) {
-        if (explosions[i].active) {
-            int base_x = explosions[i].x;
-            int base_y = explosions[i].y;
-
-            *DRAW_COLORS = 4;
-            rect(base_x + random_int(-2, 2), base_y + random_int(-2, 2), 2, 2);
-
-            *DRAW_COLORS = 4;
-            rect(base_x + random_int(-3, 3), base_y + random_int(-3, 3), 3, 3);
-            
-            *DRAW_COLORS = 3;
-            rect(base_x + random_int(-1, 1), base_y + random_int(-1, 1), 2, 2);
-        }
-    }
+// Entrada ao vivo dos gamepads e do mouse
+uint32_t read_live_input()
+{
+    uint32_t input = 0;
+    for (int p = 0; p < MAX_PLAYERS; ++p)
+        input |= (uint32_t)GAMEPAD1[p] << (p * 8);
+    if ((*MOUSE_BUTTONS & MOUSE_BUTTON_LEFT) && !netplay_active())
+        input |= INPUT_MOUSE_LEFT;
+    return input;
+}
+
+/**
+ * Retorna a entrada do quadro: a da gravação durante a reprodução, a do
+ * piloto automático na demonstração ou a dos gamepads e do mouse, com a do
+ * jogador 1 indo para a gravação durante a partida.
+ */
+uint32_t read_frame_input()
+{
+    if (replay_mode == REPLAY_PLAYING)
+    {
+        int input = replay_next_input();
+        if (input >= 0)
+            return (uint32_t)input;
+
+        // Fim da gravação: volta ao menu sem repassar a entrada ao vivo
+        replay_mode = REPLAY_IDLE;
+        game.game_state = GAME_STATE_MENU;
+        return 0;
+    }
+
+    uint32_t input = read_live_input();
+    if (replay_mode == REPLAY_ATTRACT)
+    {
+        // Uma entrada encerra a demonstração e volta ao menu, que só passa a
+        // receber a entrada ao vivo depois que tudo for solto
+        if (game.game_state == GAME_STATE_PLAYING && !input)
+            return autopilot_gamepad(0);
+        game.game_state = GAME_STATE_MENU;
+        if (!input)
+            replay_mode = REPLAY_IDLE;
+        return 0;
+    }
+    if (replay_mode == REPLAY_RECORDING && game.game_state == GAME_STATE_PLAYING)
+        replay_record(INPUT_PLAYER(input, 0));
+    return input;
+}
+
+// --- Disco Persistente ---
+
+// Checksum FNV-1a do bloco de salvamento (todos os campos antes de `checksum`)
+uint32_t save_checksum(const SaveBlock *save)
+{
+    const uint8_t *bytes = (const uint8_t *)save;
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < (int)sizeof(SaveBlock) - (int)sizeof(uint32_t); ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Lê o disco para `disk`. Um bloco de salvamento vazio, de outra versão ou
+ * corrompido volta aos valores padrão; uma gravação inválida é descartada.
+ */
+void disk_load()
+{
+    uint32_t size = diskr(&disk, sizeof(disk));
+
+    SaveBlock *save = &disk.save;
+    if (size < sizeof(SaveBlock) || save->magic != SAVE_MAGIC || save->version != SAVE_VERSION ||
+        save->checksum != save_checksum(save))
+    {
+        *save = (SaveBlock){.magic = SAVE_MAGIC, .version = SAVE_VERSION};
+    }
+
+    ReplayHeader *header = &disk.replay.header;
+    uint32_t replay_size = size > sizeof(SaveBlock) ? size - sizeof(SaveBlock) : 0;
+    if (replay_size < sizeof(ReplayHeader) || header->magic != REPLAY_MAGIC || header->version != REPLAY_VERSION ||
+        header->length > replay_size - sizeof(ReplayHeader))
+    {
+        *header = (ReplayHeader){0};
+    }
+}
+
+// Grava o bloco de salvamento e a gravação com um único diskw()
+void disk_write()
+{
+    disk.save.checksum = save_checksum(&disk.save);
+    diskw(&disk, sizeof(SaveBlock) + sizeof(ReplayHeader) + disk.replay.header.length);
+    save_delay = 0;
+}
+
+/**
+ * Agenda a gravação do disco para daqui a `frames` quadros. Pedidos seguidos
+ * se juntam em uma só escrita, e um pedido mais urgente antecipa o pendente.
+ */
+void save_request(int frames)
+{
+    if (save_delay == 0 || frames < save_delay)
+        save_delay = frames;
+}
+
+// Grava agora se houver uma gravação pendente
+void save_flush()
+{
+    if (save_delay > 0)
+        disk_write();
+}
+
+// Avança a espera da gravação pendente; chamada uma vez por quadro
+void save_tick()
+{
+    if (save_delay > 0 && --save_delay == 0)
+        disk_write();
+}
+
+/**
+ * Registra o resultado da partida que terminou: insere a pontuação entre os
+ * recordes e guarda a onda alcançada. Reproduções e demonstrações não contam
+ * como partidas.
+ */
+void save_game_result(int final_score, int wave)
+{
+    if (replay_mode == REPLAY_PLAYING || replay_mode == REPLAY_ATTRACT)
+        return;
+
+    SaveBlock *save = &disk.save;
+    uint32_t value = final_score > 0 ? (uint32_t)final_score : 0;
+    for (int i = 0; i < SAVE_HIGH_SCORES; ++i)
+    {
+        if (value > save->high_scores[i])
+        {
+            uint32_t displaced = save->high_scores[i];
+            save->high_scores[i] = value;
+            value = displaced;
+        }
+    }
+    save->last_wave = (uint8_t)minimum(wave, 255);
+    save_request(1);
+}
+
+// Liga ou desliga uma opção salva e agenda a gravação
+void save_set_option(uint8_t option, int enabled)
+{
+    uint8_t options = enabled ? (disk.save.options | option) : (disk.save.options & (uint8_t)~option);
+    if (options == disk.save.options)
+        return;
+    disk.save.options = options;
+    save_request(SAVE_DEBOUNCE_FRAMES);
+}
+
+// --- Funções de Inicialização ---
+
+/**
+ * Posiciona as estrelas do fundo em locais aleatórios das camadas.
+ */
+void init_stars(int first, int last)
+{
+    for (int i = first; i < last; ++i)
+    {
+        stars[i].x = (uint8_t)cosmetic_int(0, 159);
+        stars[i].y = (uint8_t)cosmetic_int(0, 159);
+    }
+}
+
+/**
+ * Liga ou desliga o fundo denso (STAR_COUNT_DENSE estrelas).
+ * Só é viável porque cada estrela é uma escrita direto no framebuffer.
+ */
+void set_dense_starfield(int dense)
+{
+    int count = dense ? STAR_COUNT_DENSE : STAR_COUNT;
+    if (count > star_count)
+    {
+        init_stars(star_count, count);
+    }
+    star_count = count;
+}
+
+/**
+ * Liga ou desliga o modo de retângulos sujos.
+ * O próximo quadro é sempre redesenhado por inteiro.
+ */
+void set_dirty_rendering(int enabled)
+{
+    dirty_rendering = enabled;
+    if (enabled)
+        *SYSTEM_FLAGS |= SYSTEM_PRESERVE_FRAMEBUFFER;
+    else
+        *SYSTEM_FLAGS &= (uint8_t)~SYSTEM_PRESERVE_FRAMEBUFFER;
+    render_full = TRUE;
+}
+
+/**
+ * Carrega da tabela de ondas os parâmetros da onda atual: tamanho da formação,
+ * velocidade, ritmo de tiro e o tipo de cada linha. Depois da última entrada
+ * as ondas repetem a mais difícil.
+ */
+void load_wave()
+{
+    const WaveDescriptor *wave = &wave_table[minimum(game.current_wave, WAVE_COUNT) - 1];
+    game.current_alien_rows = wave->size >> 4;
+    game.current_alien_cols = wave->size & 0xf;
+    game.current_alien_move_delay = wave->move_delay;
+    game.enemy_fire_delay = wave->fire_delay;
+    // Depois da tabela a formação continua acelerando, um pouco por onda
+    int extra_waves = maximum(game.current_wave - WAVE_COUNT, 0);
+    game.alien_speed = minimum(FIXED(ALIEN_STEP) / wave->move_delay + extra_waves * ALIEN_SPEED_RAMP, ALIEN_SPEED_MAX);
+    // Na ondulação, a formação cheia leva move_delay quadros por passo, como no modo fixo
+    int aliens = game.current_alien_rows * game.current_alien_cols;
+    game.ripple_rate = maximum((aliens + game.current_alien_move_delay - 1) / game.current_alien_move_delay, 1);
+    for (int row = 0; row < ALIEN_ROWS; ++row)
+        game.row_type[row] = (uint8_t)((wave->row_types >> (2 * row)) & 3);
+}
+
+/**
+ * Posiciona os alienígenas na formação inicial.
+ */
+void init_aliens()
+{
+    game.aliens_left = 0;
+
+    // Limita o número de linhas e colunas
+    if (game.current_alien_rows > ALIEN_ROWS)
+    {
+        game.current_alien_rows = ALIEN_ROWS;
+    }
+    if (game.current_alien_cols > ALIEN_COLS)
+    {
+        game.current_alien_cols = ALIEN_COLS;
+    }
+
+    // Liga um bit por alienígena vivo; os slots restantes ficam mortos
+    uint64_t row_mask = (1ull << game.current_alien_cols) - 1;
+    game.formation.alive = 0;
+    for (int y = 0; y < game.current_alien_rows; ++y)
+    {
+        game.formation.alive |= row_mask << (y * ALIEN_COLS);
+    }
+    game.aliens_left = game.current_alien_rows * game.current_alien_cols;
+
+    game.formation.x = ALIEN_START_X;
+    game.formation.y = ALIEN_START_Y;
+    game.formation.frame = 0;
+    game.formation.travel = 0;
+    game.formation.remainder = 0;
+    game.formation.ripple_cursor = 0;
+    game.formation.step_dx = game.formation.step_dy = 0;
+    formation_update_bounds();
+    formation_dirty_rows = (1u << ALIEN_ROWS) - 1;
+}
+
+// Esvazia o pool de explosões, devolvendo todos os índices à pilha de livres
+void init_explosions()
+{
+    explosion_count = 0;
+    explosion_free_count = EXPLOSION_CAPACITY;
+    for (int i = 0; i < EXPLOSION_CAPACITY; ++i)
+    {
+        explosion_free[i] = (uint8_t)(EXPLOSION_CAPACITY - 1 - i);
+    }
+}
+
+// Cria uma explosão na posição especificada (ignorada se o pool estiver cheio)
+
+void create_explosion(int x, int y) {
+    if (explosion_free_count == 0)
+        return;
+    uint8_t i = explosion_free[--explosion_free_count];
+    explosions[i] = (Explosion){.x = x, .y = y, .life = EXPLOSION_DURATION};
+    explosion_active[explosion_count++] = i;
+}
+
+// Registra um evento do quadro (descartado se a fila estiver cheia)
+void push_event(int type, int subject, int x, int y)
+{
+    if ((uint8_t)(event_tail - event_head) == EVENT_CAPACITY)
+        return;
+    event_ring[event_tail++ % EVENT_CAPACITY] = (Event){(uint8_t)type, (uint8_t)subject, (int16_t)x, (int16_t)y};
+}
+
+// Esvazia o pool de projéteis
+void clear_projectiles()
+{
+    game.projectile_count = 0;
+    for (int p = 0; p < MAX_PLAYERS; ++p)
+        game.players[p].bullets = 0;
+}
+
+/**
+ * Coloca o jogador p na partida, vivo e na sua posição inicial.
+ * Sozinho, o jogador 1 começa no centro da tela.
+ */
+void spawn_player(int p)
+{
+    static const uint8_t start_x[MAX_PLAYERS] = {76, 36, 116, 56};
+    game.players[p] = (Player){.x = start_x[p], .y = PLAYER_START_Y, .joined = TRUE, .alive = TRUE};
+}
+
+/**
+ * Reinicia o estado da partida para um novo jogo com os jogadores dos bits
+ * de `players`. O gerador da jogabilidade recomeça de `seed`, então as mesmas
+ * entradas reproduzem a mesma partida.
+ */
+void new_game(uint32_t seed, uint32_t players)
+{
+    game.game_state = GAME_STATE_PLAYING;
+    game.random_seed = seed;
+
+    game.score = 0;
+    game.current_wave = 1;
+    load_wave();
+    init_aliens();
+    for (int p = 0; p < MAX_PLAYERS; ++p)
+    {
+        if (players & (1u << p))
+            spawn_player(p);
+        else
+            game.players[p] = (Player){0};
+    }
+    clear_projectiles();
+    game.enemy_fire_timer = game.enemy_fire_delay;
+    game.alien_direction = 1;
+    game.wave_intro = 0;
+}
+
+/**
+ * Função principal de inicialização do jogo.
+ * É chamada uma única vez quando o cartucho é carregado.
+ */
+void start()
+{
+    STACK_PAINT_INIT();
+    set_palette();
+    init_stars(0, STAR_COUNT);
+
+    game.current_wave = 1;
+    load_wave();
+    init_aliens();
+
+    clear_projectiles();
+    game.game_state = GAME_STATE_MENU;
+    init_explosions();
+
+    set_dirty_rendering(DIRTY_RENDERING);
+
+    disk_load();
+    if (disk.save.options & SAVE_OPTION_DENSE_STARS)
+        set_dense_starfield(TRUE);
+}
+
+// --- Funções de Lógica e Comportamento do Jogo ---
+
+/**
+ * Toca o próximo evento do canal c, ou libera o canal se o padrão acabou.
+ */
+void seq_advance(int c)
+{
+    SeqChannel *channel = &seq_channels[c];
+    const Pattern *pattern = channel->pattern;
+    if (channel->position == pattern->length)
+    {
+        if (!(pattern->flags & SEQ_LOOP))
+        {
+            seq_active &= ~(1u << c);
+            return;
+        }
+        channel->position = 0;
+    }
+
+    const uint8_t *event = pattern->events + 2 * channel->position++;
+    uint32_t frames = event[1] & SEQ_DURATION_MASK;
+    channel->timer = (uint8_t)frames;
+    if (event[0] != NOTE_REST)
+    {
+        uint32_t volume = ((uint32_t)(event[1] >> SEQ_VOLUME_SHIFT) + 1) * SEQ_VOLUME_STEP;
+        tone(event[0], frames, volume, (uint32_t)c | TONE_NOTE_MODE);
+    }
+}
+
+/**
+ * Começa um padrão no canal dele, a menos que o canal esteja ocupado por um
+ * padrão de prioridade maior. A primeira nota sai já neste quadro.
+ */
+void seq_play(const Pattern *pattern)
+{
+    int c = pattern->channel;
+    if ((seq_active & (1u << c)) && seq_channels[c].pattern->priority > pattern->priority)
+        return;
+    seq_channels[c] = (SeqChannel){pattern, 0, 0};
+    seq_active |= 1u << c;
+    seq_advance(c);
+}
+
+/**
+ * Avança o sequenciador um quadro. Só percorre os canais ativos.
+ */
+void seq_update()
+{
+    for (uint32_t active = seq_active; active; active &= active - 1)
+    {
+        int c = __builtin_ctz(active);
+        if (--seq_channels[c].timer == 0)
+            seq_advance(c);
+    }
+}
+
+/**
+ * Acrescenta um projétil ao pool. Retorna FALSE se o pool estiver cheio.
+ */
+int spawn_projectile(int x, int y, int vy, uint8_t owner)
+{
+    if (game.projectile_count == PROJECTILE_CAPACITY)
+        return FALSE;
+    int i = game.projectile_count++;
+    game.projectile_x[i] = (int16_t)x;
+    game.projectile_y[i] = (int16_t)y;
+    game.projectile_vy[i] = (int8_t)vy;
+    game.projectile_owner[i] = owner;
+    if (owner != OWNER_ALIEN)
+        game.players[owner].bullets++;
+    return TRUE;
+}
+
+// Remove o projétil i trocando-o pelo último do pool
+void remove_projectile(int i)
+{
+    if (game.projectile_owner[i] != OWNER_ALIEN)
+        game.players[game.projectile_owner[i]].bullets--;
+    int last = --game.projectile_count;
+    game.projectile_x[i] = game.projectile_x[last];
+    game.projectile_y[i] = game.projectile_y[last];
+    game.projectile_vy[i] = game.projectile_vy[last];
+    game.projectile_owner[i] = game.projectile_owner[last];
+}
+
+/**
+ * Processa a entrada do jogador p, move a nave e gerencia o disparo.
+ * Quem ainda não está na partida entra nela ao apertar o botão de tiro.
+ */
+void update_player(int p, uint8_t gamepad)
+{
+    Player *player = &game.players[p];
+    if (!player->joined && (gamepad & BUTTON_1))
+    {
+        spawn_player(p);
+        // A gravação só tem a entrada do jogador 1: termina aqui e continua reproduzível
+        if (replay_mode == REPLAY_RECORDING)
+            replay_finish_recording();
+    }
+    if (!player->alive)
+        return;
+
+    // Movimento horizontal
+    if (gamepad & BUTTON_LEFT)
+        player->x -= PLAYER_SPEED;
+    if (gamepad & BUTTON_RIGHT)
+        player->x += PLAYER_SPEED;
+
+    // Limita posição do jogador
+    if (player->x < 0)
+        player->x = 0;
+    if (player->x > 160 - PLAYER_SIZE)
+        player->x = 160 - PLAYER_SIZE;
+
+    // Disparo do projétil (não há alvos no intervalo entre ondas)
+    if (player->fire_cooldown > 0)
+        player->fire_cooldown--;
+    if ((gamepad & BUTTON_1) && player->fire_cooldown == 0 && !game.wave_intro && player->bullets < PLAYER_BULLET_LIMIT &&
+        spawn_projectile(player->x + 3, player->y, -BULLET_SPEED, (uint8_t)p))
+    {
+        player->fire_cooldown = PLAYER_FIRE_COOLDOWN;
+        push_event(EVENT_SHOT, p, player->x, player->y);
+    }
+}
+
+/**
+ * Move todos os projéteis em uma única passada e descarta os que saíram da
+ * tela. A passada vai do fim para o começo, então a remoção por troca com o
+ * último nunca pula um projétil.
+ */
+void update_projectiles()
+{
+    for (int i = game.projectile_count - 1; i >= 0; --i)
+    {
+        PROFILE_WORK(1);
+        game.projectile_y[i] = (int16_t)(game.projectile_y[i] + game.projectile_vy[i]);
+        if ((unsigned)game.projectile_y[i] >= SCREEN_SIZE)
+            remove_projectile(i);
+    }
+}
+
+/**
+ * Faz os alienígenas atirarem em intervalos sorteados: o tiro sai do
+ * alienígena vivo mais baixo de uma coluna viva sorteada.
+ */
+void update_enemy_fire()
+{
+    if (--game.enemy_fire_timer > 0)
+        return;
+    game.enemy_fire_timer = random_int(ENEMY_FIRE_DELAY_MIN, game.enemy_fire_delay);
+    if (!game.formation.columns)
+        return;
+
+    uint32_t columns = game.formation.columns;
+    for (int skip = random_int(0, __builtin_popcount(columns) - 1); skip > 0; --skip)
+        columns &= columns - 1;
+    int col = __builtin_ctz(columns);
+
+    for (int row = ALIEN_ROWS - 1; row >= 0; --row)
+    {
+        int index = row * ALIEN_COLS + col;
+        if (game.formation.alive & (1ull << index))
+        {
+            spawn_projectile(alien_x(index) + 3, alien_y(index) + ALIEN_SIZE, ENEMY_BULLET_SPEED, OWNER_ALIEN);
+            return;
+        }
+    }
+}
+
+// Verifica se a caixa envolvente dos vivos chegou na borda para onde a formação anda
+int formation_at_edge()
+{
+    return game.formation.alive && ((game.formation.right >= 160 && game.alien_direction > 0) ||
+                                    (game.formation.left <= 0 && game.alien_direction < 0));
+}
+
+/**
+ * Soma `velocity` (8.8) à fração acumulada em `*remainder` e retorna os
+ * pixels inteiros a andar neste quadro; a sobra fica para os próximos.
+ */
+int fixed_advance(fixed *remainder, fixed velocity)
+{
+    fixed total = *remainder + velocity;
+    *remainder = total & FIXED_FRACTION;
+    return total >> FIXED_SHIFT;
+}
+
+/**
+ * Move a formação de alienígenas um pouco a cada quadro, com a velocidade
+ * fracionária da onda. Na borda ela desce ALIEN_STEP pixels e inverte o
+ * sentido. A animação troca de quadro a cada ALIEN_STEP pixels andados.
+ */
+void update_aliens()
+{
+    if (formation_at_edge())
+    {
+        game.alien_direction *= -1;
+        game.formation.frame ^= 1;
+        formation_move(0, ALIEN_STEP);
+        return;
+    }
+
+    int dx = fixed_advance(&game.formation.remainder, game.alien_speed);
+    if (!dx)
+        return;
+    formation_move(game.alien_direction > 0 ? dx : -dx, 0);
+    game.formation.travel = (uint8_t)(game.formation.travel + dx);
+    if (game.formation.travel >= ALIEN_STEP)
+    {
+        game.formation.travel = (uint8_t)(game.formation.travel - ALIEN_STEP);
+        game.formation.frame ^= 1;
+    }
+}
+
+/**
+ * Move a formação em ondulação, como no fliperama: a cada quadro só os
+ * próximos ripple_rate alienígenas vivos (em ordem de slot) dão o passo.
+ * O custo por quadro fica fixo e a formação acelera sozinha conforme
+ * aliens_left cai, porque a varredura encurta. Quando todos deram o passo,
+ * ele passa para a origem e a próxima varredura decide a direção.
+ */
+void update_aliens_ripple()
+{
+    Formation *formation = &game.formation;
+    if (!formation->step_dx && !formation->step_dy)
+    {
+        if (!formation->alive)
+            return;
+        if (formation_at_edge())
+        {
+            game.alien_direction *= -1;
+            formation->step_dy = ALIEN_STEP;
+        }
+        else
+        {
+            formation->step_dx = (int8_t)(game.alien_direction * ALIEN_STEP);
+        }
+        formation_update_bounds();
+    }
+
+    uint64_t pending = formation->alive & ~((1ull << formation->ripple_cursor) - 1);
+    for (int n = game.ripple_rate; n > 0 && pending; --n)
+    {
+        PROFILE_WORK(1);
+        formation->ripple_cursor = __builtin_ctzll(pending) + 1;
+        pending &= pending - 1;
+    }
+    if (pending)
+        return;
+
+    // Varredura completa: todos estão na nova posição
+    formation->x += formation->step_dx;
+    formation->y += formation->step_dy;
+    formation->frame ^= 1;
+    formation->ripple_cursor = 0;
+    formation->step_dx = formation->step_dy = 0;
+    formation_update_bounds();
+}
+
+/*
+    * Atualiza o estado das explosões, diminuindo sua vida e desativando-as quando necessário.
+    * As que expiram voltam para a pilha de livres e a lista de ativas é compactada na ordem.
+*/
+void update_explosions() {
+    int kept = 0;
+    for (int i = 0; i < explosion_count; ++i) {
+        PROFILE_WORK(1);
+        uint8_t index = explosion_active[i];
+        if (--explosions[index].life <= 0) {
+            explosion_free[explosion_free_count++] = index;
+        } else {
+            explosion_active[kept++] = index;
+        }
+    }
+    explosion_count = kept;
+}
+
+/**
+ * Termina a partida: registra o resultado, volta ao menu e reinicia o estado do jogo.
+ */
+void game_over()
+{
+    game.game_state = GAME_STATE_MENU;
+    save_game_result(game.score, game.current_wave);
+
+    push_event(EVENT_GAME_OVER, 0, 0, 0);
+
+    // Reinicia estado do jogo
+    game.current_wave = 1;
+    load_wave();
+    init_aliens();
+    for (int p = 0; p < MAX_PLAYERS; ++p)
+        game.players[p] = (Player){0};
+    clear_projectiles();
+    game.score = 0;
+    game.alien_direction = 1;
+}
+
+/**
+ * Tira o jogador p da onda atual; ele volta na próxima. A partida só termina
+ * no fim do quadro, quando não sobra nenhum jogador vivo (ver finish_frame).
+ */
+void kill_player(int p)
+{
+    game.players[p].alive = FALSE;
+    push_event(EVENT_PLAYER_HIT, p, game.players[p].x, game.players[p].y);
+}
+
+// Verifica se algum jogador ainda está vivo
+int any_player_alive()
+{
+    for (int p = 0; p < MAX_PLAYERS; ++p)
+    {
+        if (game.players[p].alive)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * Verifica colisões dos projéteis: os dos jogadores contra a formação (pelas
+ * células da grade sob o projétil) e os dos alienígenas contra cada jogador vivo.
+ */
+void check_collisions()
+{
+    for (int i = game.projectile_count - 1; i >= 0; --i)
+    {
+        PROFILE_WORK(1);
+        int x = game.projectile_x[i], y = game.projectile_y[i];
+        if (game.projectile_owner[i] != OWNER_ALIEN)
+        {
+            // Fora da caixa envolvente da formação não há o que procurar na grade
+            if (x >= game.formation.right || x + PROJECTILE_WIDTH <= game.formation.left ||
+                y >= game.formation.bottom || y + PROJECTILE_HEIGHT <= game.formation.top)
+                continue;
+
+            int hit = formation_hit(x, y, PROJECTILE_WIDTH, PROJECTILE_HEIGHT);
+            if (hit < 0)
+                continue;
+            remove_projectile(i);
+            push_event(EVENT_ALIEN_KILLED, hit, alien_x(hit), alien_y(hit));
+            formation_kill(hit);
+            game.score += alien_types[game.row_type[hit / ALIEN_COLS]].points;
+            game.aliens_left--;
+        }
+        else
+        {
+            for (int p = 0; p < MAX_PLAYERS; ++p)
+            {
+                Player *player = &game.players[p];
+                if (player->alive && x < player->x + PLAYER_SIZE && x + PROJECTILE_WIDTH > player->x &&
+                    y < player->y + PLAYER_SIZE && y + PROJECTILE_HEIGHT > player->y)
+                {
+                    remove_projectile(i);
+                    kill_player(p);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Prepara a próxima onda de alienígenas, aumentando a dificuldade.
+ * A onda começa com o intervalo "WAVE N": por WAVE_INTRO_FRAMES quadros a
+ * formação fica escondida e parada e ninguém atira, enquanto as faixas dela
+ * são recompostas uma por quadro (ver prepare_formation_row).
+ */
+void next_wave()
+{
+    game.current_wave++;
+
+    // Formação, velocidade e tipos vêm da tabela de ondas
+    load_wave();
+    init_aliens();
+    game.alien_direction = 1;
+    game.enemy_fire_timer = game.enemy_fire_delay;
+    game.wave_intro = WAVE_INTRO_FRAMES;
+
+    // Quem foi atingido na onda anterior volta, sem tiros da onda anterior na tela
+    for (int p = 0; p < MAX_PLAYERS; ++p)
+        game.players[p].alive = game.players[p].joined;
+    clear_projectiles();
+
+    // Jingle de vitória
+    push_event(EVENT_WAVE_CLEARED, 0, 0, 0);
+}
+
+/**
+ * Verifica colisões entre os alienígenas e os jogadores vivos.
+ * Um jogador tocado sai da onda (ver kill_player).
+ */
+void check_player_collision()
+{
+    for (int p = 0; p < MAX_PLAYERS; ++p)
+    {
+        Player *player = &game.players[p];
+        int p_x = player->x, p_y = player->y, p_w = PLAYER_SIZE, p_h = PLAYER_SIZE;
+
+        // Enquanto a formação está longe, a caixa envolvente descarta tudo de uma vez
+        if (!player->alive || !(p_x < game.formation.right && p_x + p_w > game.formation.left &&
+                                p_y < game.formation.bottom && p_y + p_h > game.formation.top))
+        {
+            continue;
+        }
+
+        // Verifica colisão
+        if (formation_hit(p_x, p_y, p_w, p_h) >= 0)
+        {
+            kill_player(p);
+        }
+    }
+}
+
+/**
+ * Decide o resultado do quadro depois das colisões: sem jogador vivo a
+ * partida termina; sem alienígenas, começa a próxima onda.
+ */
+void finish_frame()
+{
+    if (!any_player_alive())
+        game_over();
+    else if (game.aliens_left <= 0)
+        next_wave();
+}
+
+/**
+ * Esvazia a fila de eventos: cria as explosões e toca os sons. Cada som toca
+ * no máximo uma vez por quadro exibido, na ordem dos tipos, e o sequenciador
+ * decide pela prioridade quando dois disputam o mesmo canal. Com o fim da
+ * partida na fila, o jogador atingido não explode nem soa: só o som de fim de
+ * partida toca.
+ */
+void dispatch_events()
+{
+    uint32_t types = 0; // Bit t ligado = algum evento do tipo t na fila
+    for (uint8_t i = event_head; i != event_tail; ++i)
+        types |= 1u << event_ring[i % EVENT_CAPACITY].type;
+    if (types & (1u << EVENT_GAME_OVER))
+        types &= ~(1u << EVENT_PLAYER_HIT);
+    while (event_head != event_tail)
+    {
+        const Event *event = &event_ring[event_head++ % EVENT_CAPACITY];
+        if ((types >> event->type) & 1 && (event->type == EVENT_ALIEN_KILLED || event->type == EVENT_PLAYER_HIT))
+            create_explosion(event->x, event->y);
+    }
+    for (; types; types &= types - 1)
+        seq_play(event_sounds[__builtin_ctz(types)]);
+}
+
+// --- Funções de Desenho e UI (Interface do Usuário) ---
+
+// Estrelas desenhadas no nível de qualidade atual
+int quality_star_count()
+{
+    return quality_level >= QUALITY_FEWER_STARS ? star_count / 2 : star_count;
+}
+
+// Indica se a explosão na posição `position` da lista de ativas aparece neste quadro
+int explosion_visible(int position)
+{
+    return quality_level < QUALITY_ALTERNATE_EXPLOSIONS || ((uint32_t)position + quality_frame) % 2 == 0;
+}
+
+/**
+ * Estima o custo de desenhar o quadro da partida no nível `level`, com os
+ * pesos QUALITY_*_COST. No intervalo entre ondas a formação não aparece.
+ */
+int quality_cost(int level)
+{
+    int cost = QUALITY_FIXED_COST + game.projectile_count * QUALITY_PROJECTILE_COST;
+    for (int p = 0; p < MAX_PLAYERS; ++p)
+    {
+        if (game.players[p].alive)
+            cost += QUALITY_PLAYER_COST;
+    }
+    for (int row = 0; row < ALIEN_ROWS && !game.wave_intro; ++row)
+    {
+        if ((game.formation.alive >> (row * ALIEN_COLS)) & ALIEN_ROW_MASK)
+            cost += QUALITY_ROW_COST;
+    }
+
+    int stars = level >= QUALITY_FEWER_STARS ? star_count / 2 : star_count;
+    int explosions = level >= QUALITY_ALTERNATE_EXPLOSIONS ? (explosion_count + 1) / 2 : explosion_count;
+    int explosion_cost = level >= QUALITY_SIMPLE_EXPLOSIONS ? QUALITY_SIMPLE_EXPLOSION_COST : QUALITY_EXPLOSION_COST;
+    return cost + stars / 2 * QUALITY_STAR_PAIR_COST + explosions * explosion_cost;
+}
+
+/**
+ * Ajusta o nível de qualidade antes de desenhar. Reduz um nível depois de
+ * QUALITY_DOWN_FRAMES quadros acima do orçamento e só volta quando o nível
+ * anterior caberia em 7/8 do orçamento por QUALITY_UP_FRAMES quadros, para
+ * não alternar a cada quadro perto do limite. Com 7/8, a partida solo com o
+ * fundo denso e a formação inteira ainda volta ao nível cheio.
+ */
+void update_quality()
+{
+    quality_frame++;
+    if (quality_cost(quality_level) > QUALITY_BUDGET)
+    {
+        quality_calm = 0;
+        if (quality_level < QUALITY_LEVELS - 1 && ++quality_strain >= QUALITY_DOWN_FRAMES)
+        {
+            quality_level++;
+            quality_strain = 0;
+        }
+        return;
+    }
+
+    quality_strain = 0;
+    if (quality_level > QUALITY_FULL && quality_cost(quality_level - 1) <= QUALITY_BUDGET * 7 / 8)
+    {
+        if (++quality_calm >= QUALITY_UP_FRAMES)
+        {
+            quality_level--;
+            quality_calm = 0;
+        }
+    }
+    else
+    {
+        quality_calm = 0;
+    }
+}
+
+/**
+ * Rola as camadas para baixo, voltando pelo topo. As mais distantes (e
+ * escuras) andam mais devagar: meio, um e dois pixels por quadro.
+ */
+void scroll_star_layers()
+{
+    for (int layer = 0; layer < STAR_LAYERS; ++layer)
+    {
+        star_scroll[layer] += 1 << layer;
+        if (star_scroll[layer] >= 2 * SCREEN_SIZE)
+            star_scroll[layer] -= 2 * SCREEN_SIZE;
+    }
+}
+
+// Linha da tela da estrela com a camada rolada `scroll_y` pixels
+int star_screen_y(const Star *star, int scroll_y)
+{
+    int y = star->y + scroll_y;
+    return y >= SCREEN_SIZE ? y - SCREEN_SIZE : y;
+}
+
+// Escreve no framebuffer as stars_drawn estrelas na posição atual das camadas
+void draw_star_pixels()
+{
+    uint8_t *framebuffer = FRAMEBUFFER;
+    for (int layer = 0; layer < STAR_LAYERS; ++layer)
+    {
+        int scroll_y = star_scroll[layer] >> 1;
+        uint8_t ink = (uint8_t)(layer + 1);
+        for (int i = layer; i < stars_drawn; i += STAR_LAYERS)
+        {
+            PROFILE_WORK(1);
+            const Star *star = &stars[i];
+            int offset = star_screen_y(star, scroll_y) * FRAMEBUFFER_STRIDE + (star->x >> 2);
+            int shift = (star->x & 3) * 2;
+            framebuffer[offset] = (uint8_t)((framebuffer[offset] & ~(3 << shift)) | ink << shift);
+        }
+    }
+}
+
+/**
+ * Desenha o fundo animado de estrelas em camadas de paralaxe. Só as camadas
+ * se movem; cada estrela é um pixel escrito direto no framebuffer, na cor da
+ * sua camada (cores 2 a 4, da mais distante à mais próxima).
+ */
+void draw_background_stars()
+{
+    scroll_star_layers();
+    stars_drawn = quality_star_count();
+    draw_star_pixels();
+}
+
+/**
+ * Desenha a nave do jogador p na cor dele.
+ * Só há três cores visíveis, então o jogador 4 repete a cor do jogador 1.
+ */
+void draw_player(int p)
+{
+    static const uint16_t colors[MAX_PLAYERS] = {ATLAS_DRAW_COLORS, 0x4420, 0x4220, ATLAS_DRAW_COLORS};
+    Player *player = &game.players[p];
+    *DRAW_COLORS = colors[p];
+    draw_atlas(player->x, player->y, ATLAS_PLAYER_WIDTH, ATLAS_PLAYER_HEIGHT, ATLAS_PLAYER_X, ATLAS_PLAYER_Y, 0);
+}
+
+/**
+ * Desenha os jogadores vivos.
+ */
+void draw_players()
+{
+    for (int p = 0; p < MAX_PLAYERS; ++p)
+    {
+        if (game.players[p].alive)
+            draw_player(p);
+    }
+}
+
+/**
+ * Desenha o projétil i com o sprite do seu dono.
+ */
+void draw_projectile(int i)
+{
+    // Quadro do atlas dos projéteis dos jogadores e dos alienígenas
+    static const uint8_t sprite_x[] = {ATLAS_BULLET_X, ATLAS_ENEMY_BULLET_X};
+    static const uint8_t sprite_y[] = {ATLAS_BULLET_Y, ATLAS_ENEMY_BULLET_Y};
+    int alien = game.projectile_owner[i] == OWNER_ALIEN;
+    *DRAW_COLORS = ATLAS_DRAW_COLORS;
+    draw_atlas(game.projectile_x[i], game.projectile_y[i], PROJECTILE_WIDTH, PROJECTILE_HEIGHT, sprite_x[alien], sprite_y[alien], 0);
+}
+
+/**
+ * Desenha todos os projéteis ativos.
+ */
+void draw_projectiles()
+{
+    for (int i = 0; i < game.projectile_count; ++i)
+    {
+        PROFILE_WORK(1);
+        draw_projectile(i);
+    }
+}
+
+// Colunas da linha `row` que já deram o passo da varredura em andamento (bit c = coluna c)
+uint32_t formation_row_stepped(int row)
+{
+    int split = game.formation.ripple_cursor - row * ALIEN_COLS;
+    return split <= 0 ? 0 : split >= ALIEN_COLS ? ALIEN_ROW_MASK : (1u << split) - 1;
+}
+
+// Desenha as colunas `columns` de uma linha com uma chamada, deslocadas de (dx, dy)
+void draw_formation_columns(int row, uint32_t columns, int frame, int dx, int dy)
+{
+    if (!columns)
+        return;
+    int first = __builtin_ctz(columns) * ALIEN_SPACING;
+    int last = (31 - __builtin_clz(columns)) * ALIEN_SPACING + ALIEN_SIZE;
+    blitSub(formation_strips[frame][row], game.formation.x + first + dx, game.formation.y + row * ALIEN_SPACING + dy,
+            (uint32_t)(last - first), ALIEN_SIZE, (uint32_t)first, 0, ALIEN_STRIP_WIDTH, BLIT_2BPP);
+}
+
+/**
+ * Desenha uma linha da formação só no trecho com vivos: uma chamada, ou duas
+ * quando a varredura do modo ondulação passa pela linha.
+ */
+void draw_formation_row(int row)
+{
+    uint32_t row_alive = (uint32_t)((game.formation.alive >> (row * ALIEN_COLS)) & ALIEN_ROW_MASK);
+    if (!row_alive)
+        return;
+    PROFILE_WORK(1);
+    if (formation_dirty_rows & (1u << row))
+    {
+        render_formation_row(row);
+    }
+    uint32_t stepped = row_alive & formation_row_stepped(row);
+    int frame = game.formation.frame;
+    *DRAW_COLORS = ATLAS_DRAW_COLORS;
+    draw_formation_columns(row, stepped, frame ^ 1, game.formation.step_dx, game.formation.step_dy);
+    draw_formation_columns(row, row_alive & ~stepped, frame, 0, 0);
+}
+
+/**
+ * Recompõe a faixa desatualizada da linha mais alta, se houver. Chamada a
+ * cada quadro do intervalo entre ondas, espalha o trabalho da formação nova
+ * pelos quadros em que ela ainda não aparece; draw_formation_row continua
+ * recompondo na hora o que sobrar.
+ */
+void prepare_formation_row()
+{
+    if (formation_dirty_rows)
+        render_formation_row(__builtin_ctz(formation_dirty_rows));
+}
+
+/**
+ * Desenha os alienígenas vivos: uma chamada por linha da formação.
+ * No intervalo entre ondas a formação não aparece.
+ */
+void draw_aliens()
+{
+    if (game.wave_intro)
+        return;
+    for (int row = 0; row < ALIEN_ROWS; ++row)
+    {
+        draw_formation_row(row);
+    }
+}
+
+/**
+ * Desenha uma explosão com o quadro do atlas que corresponde à vida restante.
+ * O tremor e o espelhamento vêm de 3 bytes da tabela de tremores do quadro.
+ */
+void draw_explosion(int i)
+{
+    Explosion *explosion = &explosions[i];
+    int frame = (EXPLOSION_DURATION - explosion->life) * ATLAS_EXPLOSION_FRAMES / EXPLOSION_DURATION;
+    int src_x = ATLAS_EXPLOSION_X + frame * ATLAS_EXPLOSION_WIDTH;
+    *DRAW_COLORS = ATLAS_DRAW_COLORS;
+    if (quality_level >= QUALITY_SIMPLE_EXPLOSIONS)
+    {
+        draw_atlas(explosion->x, explosion->y, ATLAS_EXPLOSION_WIDTH, ATLAS_EXPLOSION_HEIGHT, src_x, ATLAS_EXPLOSION_Y, 0);
+        return;
+    }
+
+    // Tremor de 1 pixel e espelhamento sorteados a cada quadro
+    int j = i * 3;
+    uint32_t flip = (uint32_t)jitter_table[(j + 2) & (JITTER_TABLE_SIZE - 1)] & (BLIT_FLIP_X | BLIT_FLIP_Y);
+    draw_atlas(explosion->x + jitter(j, 1), explosion->y + jitter(j + 1, 1),
+               ATLAS_EXPLOSION_WIDTH, ATLAS_EXPLOSION_HEIGHT, src_x, ATLAS_EXPLOSION_Y, flip);
+}
+
+/**
+ * Desenha as explosões na tela.
+ * Cada explosão visível é um quadro de animação do atlas, com tremor e
+ * espelhamento próprios (ver draw_explosion).
+ */
+void draw_explosions() {
+    for (int i = 0; i < explosion_count; ++i) {
+        PROFILE_WORK(1);
+        if (explosion_visible(i))
+            draw_explosion(explosion_active[i]);
+    }
+}
+
+/**
+ * Devolve o texto "<rótulo><valor>" de um item do HUD.
+ * A string só é montada (com itoa) quando o valor muda; nos outros quadros
+ * o texto guardado é reaproveitado.
+ */
+const char *hud_format(HudText *hud, const char *label, int value)
+{
+    if (hud->value == value)
+        return hud->text;
+
+    char digits[12];
+    itoa(value, digits);
+    char *ptr = hud->text;
+    while (*label)
+        *ptr++ = *label++;
+    for (char *digit = digits; *digit;)
+        *ptr++ = *digit++;
+    *ptr = '\0';
+    hud->value = value;
+    return hud->text;
+}
+
+// Cada dígito é copiado do atlas como um byte por linha
+_Static_assert(ATLAS_DIGITS_X % 4 == 0, "os dígitos devem começar em um múltiplo de 4 pixels no atlas");
+
+/**
+ * Desenha um número do HUD em (x, y) com um único blitSub da faixa de dígitos.
+ * Os dígitos só são decompostos e copiados do atlas quando o valor muda, então
+ * redesenhar um número que não mudou não faz nenhum trabalho além do blit.
+ */
+void draw_hud_number(HudNumber *hud, int value, int x, int y)
+{
+    if (hud->value != value)
+    {
+        int digits[HUD_DIGITS];
+        int count = 0;
+        uint32_t rest = value > 0 ? (uint32_t)value : 0;
+        do
+        {
+            digits[count++] = (int)(rest % 10);
+            rest /= 10;
+        } while (rest && count < HUD_DIGITS);
+
+        for (int i = 0; i < count; ++i)
+        {
+            const uint8_t *glyph = atlas + ATLAS_DIGITS_Y * ATLAS_STRIDE +
+                                   (ATLAS_DIGITS_X + digits[count - 1 - i] * ATLAS_DIGITS_WIDTH) / 4;
+            for (int row = 0; row < ATLAS_DIGITS_HEIGHT; ++row)
+                hud->strip[row * HUD_DIGITS + i] = glyph[row * ATLAS_STRIDE];
+        }
+        hud->width = count * ATLAS_DIGITS_WIDTH;
+        hud->value = value;
+    }
+    blitSub(hud->strip, x, y, (uint32_t)hud->width, ATLAS_DIGITS_HEIGHT, 0, 0,
+            HUD_DIGITS * ATLAS_DIGITS_WIDTH, BLIT_2BPP);
 }
 
 /**
@@ -615,21 +2421,9 @@ void draw_explosions() {
  */
 void draw_score()
 {
-    char score_text[20]; // Buffer para "SCORE:" + pontuação
-
-    // Desenha a pontuação
-    char score_value[10];
-    itoa(score, score_value);
-    char *score_ptr = score_text;
-    const char *score_label = "SCORE:";
-    while (*score_label)
-        *score_ptr++ = *score_label++;
-    char *value_ptr = score_value;
-    while (*value_ptr)
-        *score_ptr++ = *value_ptr++;
-    *score_ptr = '\0';
-    *DRAW_COLORS = 3; // Cor da pontuação
-    text(score_text, 5, 5); // Posição para a pontuação
+    *DRAW_COLORS = 0x3000; // Cor da pontuação (cor 3 no índice 3 do atlas)
+    draw_atlas(5, 5, ATLAS_SCORE_LABEL_WIDTH, ATLAS_SCORE_LABEL_HEIGHT, ATLAS_SCORE_LABEL_X, ATLAS_SCORE_LABEL_Y, 0);
+    draw_hud_number(&hud_score, game.score, 5 + ATLAS_SCORE_LABEL_WIDTH, 5); // Posição para a pontuação
 }
 
 /*
@@ -637,90 +2431,672 @@ void draw_score()
  */
 void draw_wave()
 {
-    char wave_text[15]; // Buffer para "WAVE:" + onda
-
-    // Desenha a onda atual
-    char wave_value[5];
-    itoa(current_wave, wave_value);
-    char *wave_ptr = wave_text;
-    const char *wave_label = "WAVE:";
-    while (*wave_label)
-        *wave_ptr++ = *wave_label++;
-    char *value_ptr = wave_value;
-    while (*value_ptr)
-        *wave_ptr++ = *value_ptr++;
-    *wave_ptr = '\0';
-    *DRAW_COLORS = 2;
-    text(wave_text, 100, 5); // Posição para a wave
+    *DRAW_COLORS = 0x2000;
+    draw_atlas(100, 5, ATLAS_WAVE_LABEL_WIDTH, ATLAS_WAVE_LABEL_HEIGHT, ATLAS_WAVE_LABEL_X, ATLAS_WAVE_LABEL_Y, 0);
+    draw_hud_number(&hud_wave, game.current_wave, 100 + ATLAS_WAVE_LABEL_WIDTH, 5); // Posição para a wave
+}
+
+// Largura em pixels do texto "WAVE N" do intervalo entre ondas, formatado em hud_intro
+int wave_intro_width()
+{
+    const char *label = hud_format(&hud_intro, "WAVE ", game.current_wave);
+    int length = 0;
+    while (label[length])
+        length++;
+    return length * WAVE_INTRO_CHAR_SIZE;
+}
+
+// Desenha o texto "WAVE N" do intervalo entre ondas, centralizado na tela
+void draw_wave_intro()
+{
+    if (!game.wave_intro)
+        return;
+    int width = wave_intro_width();
+    *DRAW_COLORS = 4;
+    text(hud_intro.text, (SCREEN_SIZE - width) / 2, WAVE_INTRO_Y);
+}
+
+// --- Renderização por Retângulos Sujos ---
+
+/*
+ * Modo opcional em que o framebuffer é preservado entre quadros
+ * (SYSTEM_PRESERVE_FRAMEBUFFER) e só o que mudou é apagado e redesenhado.
+ * A tela é dividida em tiles de 8x8: cada camada (jogador, projétil, linhas da
+ * formação, HUD, explosões) lembra o retângulo desenhado no quadro anterior e
+ * o conteúdo dele; se algo mudou, os tiles do retângulo antigo e do novo são
+ * limpos, e toda camada que toca um tile limpo é redesenhada por inteiro.
+ * As estrelas ficam sob os sprites, como no redesenho completo: uma estrela
+ * que sai de um tile ocupado por uma camada ou entra nele suja o tile, e a
+ * camada é redesenhada por cima, então os dois modos desenham a mesma tela.
+ */
+
+#define TILE_SIZE 8                          // Lado de um tile da grade de sujeira
+#define TILE_COUNT (SCREEN_SIZE / TILE_SIZE) // Tiles por linha e por coluna
+#define TILE_ROW_FULL ((1u << TILE_COUNT) - 1)
+
+// Camadas do modo de retângulos sujos, na ordem de desenho (de trás para frente)
+enum
+{
+    RENDER_SLOT_PLAYERS,                               // Uma por jogador
+    RENDER_SLOT_ROWS = RENDER_SLOT_PLAYERS + MAX_PLAYERS, // Uma por linha da formação
+    RENDER_SLOT_SCORE = RENDER_SLOT_ROWS + ALIEN_ROWS,
+    RENDER_SLOT_WAVE,
+    RENDER_SLOT_INTRO,                                 // Texto "WAVE N" do intervalo entre ondas
+    RENDER_SLOT_PROJECTILES,                           // Uma por posição no pool de projéteis
+    RENDER_SLOT_EXPLOSIONS = RENDER_SLOT_PROJECTILES + PROJECTILE_CAPACITY, // Uma por posição na lista de ativas
+    RENDER_SLOT_COUNT = RENDER_SLOT_EXPLOSIONS + EXPLOSION_CAPACITY
+};
+
+// Estrutura para um retângulo na tela (w = 0 quando não há nada desenhado)
+typedef struct
+{
+    int x, y, w, h;
+} Rect;
+
+// Estrutura para o que uma camada desenhou no quadro anterior
+typedef struct
+{
+    Rect drawn; // Retângulo desenhado
+    int key;    // Conteúdo desenhado (muda quando o sprite precisa ser refeito)
+} RenderSlot;
+
+RenderSlot render_slots[RENDER_SLOT_COUNT];
+int render_projectile_slots;       // Camadas de projétil desenhadas no quadro anterior
+int render_explosion_slots;        // Camadas de explosão desenhadas no quadro anterior
+
+/**
+ * Retorna o retângulo (e o conteúdo em `key`) que uma camada vai desenhar neste quadro.
+ */
+Rect render_slot_rect(int slot, int *key)
+{
+    *key = 0;
+    if (slot < RENDER_SLOT_ROWS)
+    {
+        Player *player = &game.players[slot - RENDER_SLOT_PLAYERS];
+        return player->alive ? (Rect){player->x, player->y, PLAYER_SIZE, PLAYER_SIZE} : (Rect){0};
+    }
+    if (slot < RENDER_SLOT_SCORE)
+    {
+        int row = slot - RENDER_SLOT_ROWS;
+        uint32_t row_alive = (uint32_t)((game.formation.alive >> (row * ALIEN_COLS)) & ALIEN_ROW_MASK);
+        if (!row_alive || game.wave_intro)
+            return (Rect){0};
+        int first = __builtin_ctz(row_alive) * ALIEN_SPACING;
+        int last = (31 - __builtin_clz(row_alive)) * ALIEN_SPACING + ALIEN_SIZE;
+        Rect rect = {game.formation.x + first, game.formation.y + row * ALIEN_SPACING, last - first, ALIEN_SIZE};
+        // No meio de uma varredura a linha cobre as posições de antes e de depois do passo
+        uint32_t stepped = row_alive & formation_row_stepped(row);
+        if (stepped)
+        {
+            int dx = game.formation.step_dx;
+            rect.x += minimum(dx, 0);
+            rect.w += dx < 0 ? -dx : dx;
+            rect.h += game.formation.step_dy;
+        }
+        // O quadro da animação, o tipo da linha e o ponto da varredura também mudam o que a faixa desenha
+        *key = (int)(row_alive | (uint32_t)game.formation.frame << ALIEN_COLS |
+                     (uint32_t)game.row_type[row] << (ALIEN_COLS + 1) | stepped << (ALIEN_COLS + 3));
+        return rect;
+    }
+    if (slot == RENDER_SLOT_SCORE)
+    {
+        *key = game.score;
+        return (Rect){5, 5, ATLAS_SCORE_LABEL_WIDTH + HUD_DIGITS * ATLAS_DIGITS_WIDTH, ATLAS_DIGITS_HEIGHT};
+    }
+    if (slot == RENDER_SLOT_WAVE)
+    {
+        *key = game.current_wave;
+        return (Rect){100, 5, ATLAS_WAVE_LABEL_WIDTH + HUD_DIGITS * ATLAS_DIGITS_WIDTH, ATLAS_DIGITS_HEIGHT};
+    }
+    if (slot == RENDER_SLOT_INTRO)
+    {
+        if (!game.wave_intro)
+            return (Rect){0};
+        int width = wave_intro_width();
+        *key = game.current_wave;
+        return (Rect){(SCREEN_SIZE - width) / 2, WAVE_INTRO_Y, width, WAVE_INTRO_CHAR_SIZE};
+    }
+    if (slot < RENDER_SLOT_EXPLOSIONS)
+    {
+        int i = slot - RENDER_SLOT_PROJECTILES;
+        if (i >= game.projectile_count)
+            return (Rect){0};
+        *key = game.projectile_owner[i];
+        return (Rect){game.projectile_x[i], game.projectile_y[i], PROJECTILE_WIDTH, PROJECTILE_HEIGHT};
+    }
+    int position = slot - RENDER_SLOT_EXPLOSIONS;
+    if (position >= explosion_count || !explosion_visible(position))
+        return (Rect){0};
+    // As explosões tremem a cada quadro: o tempo de vida garante que sejam refeitas
+    Explosion *explosion = &explosions[explosion_active[position]];
+    *key = explosion->life;
+    return (Rect){explosion->x - 1, explosion->y - 1, ATLAS_EXPLOSION_WIDTH + 2, ATLAS_EXPLOSION_HEIGHT + 2};
+}
+
+void draw_render_slot(int slot)
+{
+    if (slot < RENDER_SLOT_ROWS)
+        draw_player(slot - RENDER_SLOT_PLAYERS);
+    else if (slot < RENDER_SLOT_SCORE)
+        draw_formation_row(slot - RENDER_SLOT_ROWS);
+    else if (slot == RENDER_SLOT_SCORE)
+        draw_score();
+    else if (slot == RENDER_SLOT_WAVE)
+        draw_wave();
+    else if (slot == RENDER_SLOT_INTRO)
+        draw_wave_intro();
+    else if (slot < RENDER_SLOT_EXPLOSIONS)
+        draw_projectile(slot - RENDER_SLOT_PROJECTILES);
+    else
+        draw_explosion(explosion_active[slot - RENDER_SLOT_EXPLOSIONS]);
+}
+
+/**
+ * Converte um retângulo em tiles: máscara de colunas e intervalo de linhas.
+ * Retorna FALSE se o retângulo está vazio ou fora da tela.
+ */
+int rect_tiles(Rect r, uint32_t *columns, int *row_first, int *row_last)
+{
+    int x0 = r.x < 0 ? 0 : r.x, y0 = r.y < 0 ? 0 : r.y;
+    int x1 = minimum(r.x + r.w, SCREEN_SIZE), y1 = minimum(r.y + r.h, SCREEN_SIZE);
+    if (r.w <= 0 || r.h <= 0 || x0 >= x1 || y0 >= y1)
+        return FALSE;
+    *columns = ((2u << ((x1 - 1) / TILE_SIZE)) - 1) & ~((1u << (x0 / TILE_SIZE)) - 1);
+    *row_first = y0 / TILE_SIZE;
+    *row_last = (y1 - 1) / TILE_SIZE;
+    return TRUE;
+}
+
+// Marca os tiles cobertos por um retângulo
+void tiles_add(uint32_t tiles[TILE_COUNT], Rect r)
+{
+    uint32_t columns;
+    int row_first, row_last;
+    if (!rect_tiles(r, &columns, &row_first, &row_last))
+        return;
+    for (int row = row_first; row <= row_last; ++row)
+        tiles[row] |= columns;
+}
+
+// Verifica se um retângulo toca algum tile marcado
+int tiles_overlap(const uint32_t tiles[TILE_COUNT], Rect r)
+{
+    uint32_t columns;
+    int row_first, row_last;
+    if (!rect_tiles(r, &columns, &row_first, &row_last))
+        return FALSE;
+    for (int row = row_first; row <= row_last; ++row)
+    {
+        if (tiles[row] & columns)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+// Verifica se o tile que contém o pixel (x, y) está marcado
+int tile_marked(const uint32_t tiles[TILE_COUNT], int x, int y)
+{
+    return (tiles[y / TILE_SIZE] >> (x / TILE_SIZE)) & 1;
+}
+
+/**
+ * Limpa (cor 0) os tiles marcados, escrevendo direto no framebuffer.
+ * Um tile de 8 pixels ocupa 2 bytes por linha, então cada sequência de tiles
+ * vizinhos vira um preenchimento contínuo por linha de pixels, e uma linha de
+ * tiles inteira vira um só preenchimento de TILE_SIZE linhas.
+ */
+void clear_tiles(const uint32_t tiles[TILE_COUNT])
+{
+    uint8_t *framebuffer = FRAMEBUFFER;
+    for (int row = 0; row < TILE_COUNT; ++row)
+    {
+        uint32_t columns = tiles[row];
+        if (columns == TILE_ROW_FULL)
+        {
+            fill_bytes(framebuffer + row * TILE_SIZE * FRAMEBUFFER_STRIDE, 0, TILE_SIZE * FRAMEBUFFER_STRIDE);
+            continue;
+        }
+        while (columns)
+        {
+            int first = __builtin_ctz(columns);
+            int count = __builtin_ctz(~(columns >> first));
+            columns &= ~(((1u << count) - 1) << first);
+            for (int y = row * TILE_SIZE; y < (row + 1) * TILE_SIZE; ++y)
+                fill_bytes(framebuffer + y * FRAMEBUFFER_STRIDE + first * (TILE_SIZE / 4), 0, count * (TILE_SIZE / 4));
+        }
+    }
+}
+
+/**
+ * Percorre as estrelas desenhadas na posição atual das camadas: suja os tiles
+ * ocupados em que alguma delas está e, com `erase`, apaga o pixel dela.
+ */
+void mark_star_tiles(uint32_t dirty[TILE_COUNT], const uint32_t occupied[TILE_COUNT], int erase)
+{
+    uint8_t *framebuffer = FRAMEBUFFER;
+    for (int layer = 0; layer < STAR_LAYERS; ++layer)
+    {
+        int scroll_y = star_scroll[layer] >> 1;
+        for (int i = layer; i < stars_drawn; i += STAR_LAYERS)
+        {
+            PROFILE_WORK(1);
+            const Star *star = &stars[i];
+            int y = star_screen_y(star, scroll_y);
+            if (tile_marked(occupied, star->x, y))
+                dirty[y / TILE_SIZE] |= 1u << (star->x / TILE_SIZE);
+            if (erase)
+                framebuffer[y * FRAMEBUFFER_STRIDE + (star->x >> 2)] &= (uint8_t)~(3 << (star->x & 3) * 2);
+        }
+    }
+}
+
+/**
+ * Desenha o quadro da partida no modo de retângulos sujos.
+ */
+void draw_playfield_dirty()
+{
+    uint32_t dirty[TILE_COUNT] = {0};    // Tiles que serão limpos e redesenhados
+    uint32_t occupied[TILE_COUNT] = {0}; // Tiles cobertos por alguma camada
+    Rect current[RENDER_SLOT_COUNT];
+    int keys[RENDER_SLOT_COUNT];
+    uint8_t redraw[RENDER_SLOT_COUNT];
+    int slots[RENDER_SLOT_COUNT];        // Camadas consideradas neste quadro, na ordem de desenho
+
+    // Dos projéteis e das explosões, só as posições ativas agora ou desenhadas
+    // no quadro anterior entram na conta
+    int slot_count = 0;
+    for (int s = 0; s < RENDER_SLOT_PROJECTILES; ++s)
+        slots[slot_count++] = s;
+    for (int i = 0; i < game.projectile_count || i < render_projectile_slots; ++i)
+        slots[slot_count++] = RENDER_SLOT_PROJECTILES + i;
+    for (int i = 0; i < explosion_count || i < render_explosion_slots; ++i)
+        slots[slot_count++] = RENDER_SLOT_EXPLOSIONS + i;
+    render_projectile_slots = game.projectile_count;
+    render_explosion_slots = explosion_count;
+
+    if (render_full)
+    {
+        for (int row = 0; row < TILE_COUNT; ++row)
+            dirty[row] = TILE_ROW_FULL;
+    }
+
+    // Camadas que mudaram sujam os tiles de onde estavam e para onde foram
+    for (int k = 0; k < slot_count; ++k)
+    {
+        PROFILE_WORK(1);
+        int s = slots[k];
+        RenderSlot *slot = &render_slots[s];
+        current[s] = render_slot_rect(s, &keys[s]);
+        Rect r = current[s], d = slot->drawn;
+        redraw[s] = render_full || keys[s] != slot->key ||
+                    r.x != d.x || r.y != d.y || r.w != d.w || r.h != d.h;
+        if (redraw[s])
+        {
+            tiles_add(dirty, d);
+            tiles_add(dirty, r);
+        }
+        tiles_add(occupied, r);
+    }
+
+    // Estrelas: apaga todos os pixels antigos antes de desenhar os novos (duas
+    // estrelas podem cair no mesmo pixel); as que saem ou entram em tiles
+    // ocupados sujam esses tiles, para que a camada seja refeita por cima
+    mark_star_tiles(dirty, occupied, TRUE);
+    scroll_star_layers();
+    stars_drawn = quality_star_count();
+    mark_star_tiles(dirty, occupied, FALSE);
+
+    // Camadas paradas que tocam tiles sujos também são refeitas, sujando seus tiles
+    for (int grew = TRUE; grew;)
+    {
+        grew = FALSE;
+        for (int k = 0; k < slot_count; ++k)
+        {
+            int s = slots[k];
+            if (!redraw[s] && current[s].w > 0 && tiles_overlap(dirty, current[s]))
+            {
+                redraw[s] = TRUE;
+                tiles_add(dirty, current[s]);
+                grew = TRUE;
+            }
+        }
+    }
+
+    clear_tiles(dirty);
+    draw_star_pixels();
+
+    for (int k = 0; k < slot_count; ++k)
+    {
+        int s = slots[k];
+        if (redraw[s] && current[s].w > 0)
+            draw_render_slot(s);
+        render_slots[s].drawn = current[s];
+        render_slots[s].key = keys[s];
+    }
+    render_full = FALSE;
 }
 
-// Atualiza tela de menu e verifica início do jogo
-void update_menu()
+/**
+ * Começa a demonstração: uma partida só com o jogador 1, jogada pelo piloto
+ * automático. Ela não é gravada nem conta como partida, e termina no fim da
+ * partida ou com qualquer entrada.
+ */
+void attract_begin()
+{
+    replay_mode = REPLAY_ATTRACT;
+    new_game(game.random_seed, 1);
+}
+
+/**
+ * Desenha o quadro da partida a partir do estado já atualizado.
+ */
+void draw_playfield()
 {
-    uint8_t gamepad = *GAMEPAD1;
+    if (explosion_count > 0 && quality_level < QUALITY_SIMPLE_EXPLOSIONS)
+    {
+        refresh_jitter_table();
+    }
+
+    // A formação nova fica pronta durante o intervalo, uma linha por quadro
+    if (game.wave_intro)
+    {
+        PROFILE_BEGIN(PHASE_ALIENS);
+        prepare_formation_row();
+        PROFILE_END(PHASE_ALIENS);
+    }
+
+    if (dirty_rendering)
+    {
+        PROFILE_BEGIN(PHASE_DIRTY);
+        draw_playfield_dirty();
+        PROFILE_END(PHASE_DIRTY);
+        return;
+    }
 
+    PROFILE_BEGIN(PHASE_STARS);
+    draw_background_stars();
+    PROFILE_END(PHASE_STARS);
+    PROFILE_BEGIN(PHASE_PLAYER);
+    draw_players();
+    PROFILE_END(PHASE_PLAYER);
+    PROFILE_BEGIN(PHASE_ALIENS);
+    draw_aliens();
+    PROFILE_END(PHASE_ALIENS);
+    PROFILE_BEGIN(PHASE_HUD);
+    draw_score();
+    draw_wave();
+    draw_wave_intro();
+    PROFILE_END(PHASE_HUD);
+    PROFILE_BEGIN(PHASE_PROJECTILES);
+    draw_projectiles();
+    PROFILE_END(PHASE_PROJECTILES);
+    PROFILE_BEGIN(PHASE_EXPLOSIONS);
+    draw_explosions();
+    PROFILE_END(PHASE_EXPLOSIONS);
+}
+
+// Desenha a tela de menu
+void draw_menu()
+{
     // Desenha o título e as instruções
     *DRAW_COLORS = 4;
     text("WASM INVADERS", 28, 50);
 
+    if (disk.save.high_scores[0] > 0)
+    {
+        *DRAW_COLORS = 2;
+        text(hud_format(&hud_best, "BEST:", (int)disk.save.high_scores[0]), 40, 64);
+    }
+
     *DRAW_COLORS = 3;
     text("Press Space", 35, 80);
     text("or click", 47, 90);
     text("to start", 47, 100);
 
-    // Lógica para iniciar o jogo:
-    // Verifica se o Botão 1 do Gamepad foi pressionado OU
-    // se o botão do mouse foi pressionado.
-    if ((gamepad & BUTTON_1) || (*MOUSE_BUTTONS & MOUSE_BUTTON_LEFT))
+    *DRAW_COLORS = 2;
+    text("Z: more stars", 28, 130);
+    if (replay_available() && !netplay_active())
+        text("Down: replay", 32, 140);
+}
+
+// Trata a entrada do menu e verifica início do jogo
+// As opções ficam com o jogador 1; qualquer jogador pode começar a partida.
+void update_menu(uint32_t input)
+{
+    uint8_t gamepad = INPUT_PLAYER(input, 0) & (uint8_t)~INPUT_MOUSE_LEFT;
+
+    // O fluxo da jogabilidade anda a cada quadro no menu, então a semente de
+    // uma partida depende do quadro em que ela começa (e, por estar em
+    // GameState, é a mesma para todos os participantes do netplay)
+    random_next(&game.random_seed);
+
+    // Botão 2 alterna o fundo denso de estrelas (só na borda de pressionar)
+    uint8_t pressed = gamepad & (gamepad ^ game.menu_previous_gamepad);
+    game.menu_previous_gamepad = gamepad;
+    if (pressed & BUTTON_2)
+    {
+        set_dense_starfield(star_count == STAR_COUNT);
+        save_set_option(SAVE_OPTION_DENSE_STARS, star_count == STAR_COUNT_DENSE);
+    }
+
+    // Parado por ATTRACT_IDLE_FRAMES quadros, o menu passa a demonstração
+    // (menos no netplay, em que ela seria jogada por todos os participantes)
+    if (input || netplay_active())
+    {
+        attract_idle = 0;
+    }
+    else if (++attract_idle >= ATTRACT_IDLE_FRAMES)
+    {
+        attract_idle = 0;
+        attract_begin();
+        return;
+    }
+
+    // Seta para baixo reproduz a última partida gravada (no netplay, o
+    // disco de cada participante é diferente e a reprodução dessincronizaria)
+    if ((pressed & BUTTON_DOWN) && replay_available() && !netplay_active())
     {
-        game_state = GAME_STATE_PLAYING;
+        replay_begin_playback();
+        new_game(disk.replay.header.gameplay_seed, 1);
+        return;
+    }
 
+    // Lógica para iniciar o jogo:
+    // Verifica se o Botão 1 de algum gamepad foi pressionado OU
+    // se o botão do mouse foi pressionado. Quem apertou já entra na partida.
+    uint32_t players = (input & INPUT_MOUSE_LEFT) ? 1 : 0;
+    for (int p = 0; p < MAX_PLAYERS; ++p)
+        players |= (uint32_t)((INPUT_PLAYER(input, p) & BUTTON_1) != 0) << p;
+    if (players)
+    {
         // Reinicia o jogo, caso o usuário queira começar de novo
-        init_aliens();
-        score = 0;
-        player.x = 76;
-        player_bullet.active = FALSE;
+        // (uma opção ainda não gravada vai para o disco antes de a gravação
+        // da partida começar a sobrescrever a anterior)
+        save_flush();
+        new_game(game.random_seed, players);
+        if (players == 1)
+            replay_begin_recording();
     }
 }
 
+#if defined(DEBUG) && defined(PROFILE_INTERVAL)
 /**
- * Função principal de atualização do jogo.
- * É chamada 60 vezes por segundo pelo WASM-4.
- * Orquestra todas as chamadas de lógica e desenho.
+ * Fecha o quadro no perfilador: atualiza os picos e, a cada PROFILE_INTERVAL
+ * quadros, imprime o resumo da janela por tracef e zera os contadores.
  */
-void update()
+void profile_frame_end()
 {
-    draw_background_stars();
+    if (explosion_count > profile_peak_explosions)
+        profile_peak_explosions = explosion_count;
+    if (game.aliens_left > profile_peak_aliens)
+        profile_peak_aliens = game.aliens_left;
+    if (profile_frame_imports > profile_peak_imports)
+        profile_peak_imports = profile_frame_imports;
+    profile_frame_imports = 0;
+
+    if (++profile_frames < PROFILE_INTERVAL)
+        return;
 
-    switch (game_state)
+    uint32_t total_imports = 0;
+    for (int p = 0; p < PHASE_COUNT; ++p)
     {
-    case GAME_STATE_MENU:
+        ProfileCounters *c = &profile_window[p];
+        total_imports += c->blit + c->rect + c->text + c->tone + c->other;
+    }
+    tracef("profile: %d frames, imports/frame avg %d peak %d, peak aliens %d, peak explosions %d, quality %d",
+           profile_frames, (int)(total_imports / (uint32_t)profile_frames), (int)profile_peak_imports,
+           profile_peak_aliens, profile_peak_explosions, quality_level);
+#ifdef __wasm__
+    tracef("  stack: peak %d of %d bytes", stack_peak(), STACK_SIZE - (int)(uintptr_t)STACK_LOW);
+#endif
+
+#define PROFILE_PHASE_NAME(id, name) name,
+    static const char *phase_names[PHASE_COUNT] = {PROFILE_PHASES(PROFILE_PHASE_NAME)};
+    for (int p = 0; p < PHASE_COUNT; ++p)
     {
-        update_menu();
-        break;
+        ProfileCounters *c = &profile_window[p];
+        if (c->blit + c->rect + c->text + c->tone + c->other + c->work == 0)
+            continue;
+        tracef("  %s: blit %d rect %d text %d tone %d other %d work %d", phase_names[p],
+               (int)c->blit, (int)c->rect, (int)c->text, (int)c->tone, (int)c->other, (int)c->work);
+        *c = (ProfileCounters){0};
     }
 
+    profile_frames = 0;
+    profile_peak_imports = 0;
+    profile_peak_aliens = 0;
+    profile_peak_explosions = 0;
+}
+#endif
+
+/**
+ * Avança um quadro da simulação com a entrada `input`. Só altera o estado do
+ * jogo (e registra eventos na fila): nada é desenhado nem tocado, então pode
+ * rodar várias vezes por quadro, como no avanço rápido das reproduções e no
+ * harness nativo.
+ */
+void simulate_frame(uint32_t input)
+{
+    switch (game.game_state)
+    {
+    case GAME_STATE_MENU:
+        PROFILE_BEGIN(PHASE_MENU);
+        update_menu(input);
+        PROFILE_END(PHASE_MENU);
+        break;
+
     case GAME_STATE_PLAYING:
     {
-        uint8_t gamepad = *GAMEPAD1;
-
-        update_player(gamepad);         // Atualiza jogador
-        update_player_bullet();         // Atualiza projétil
-        update_aliens();                // Atualiza alienígenas
-        check_collisions();             // Verifica colisão projétil-alienígena
-        check_player_collision();       // Verifica colisão jogador-alienígena
-        draw_score();                   // Desenha pontuação
-        draw_wave();                    // Desenha onda
-        play_wave_jingle();             // Toca jingle de onda
-        update_explosions();            // Atualiza explosões
-        draw_explosions();              // Desenha explosões
-
-        // Verifica se todos os alienígenas foram destruídos
-        if (aliens_left <= 0)
+        PROFILE_BEGIN(PHASE_PLAYER);
+        for (int p = 0; p < MAX_PLAYERS; ++p)
+            update_player(p, INPUT_PLAYER(input, p)); // Atualiza jogadores
+        PROFILE_END(PHASE_PLAYER);
+        PROFILE_BEGIN(PHASE_PROJECTILES);
+        update_projectiles();           // Move os projéteis
+        PROFILE_END(PHASE_PROJECTILES);
+        // No intervalo entre ondas a formação espera escondida e nada colide
+        if (game.wave_intro)
+        {
+            game.wave_intro--;
+        }
+        else
+        {
+            PROFILE_BEGIN(PHASE_ALIENS);
+            if (ripple_stepping)
+                update_aliens_ripple(); // Atualiza alienígenas, alguns por quadro
+            else
+                update_aliens();        // Atualiza alienígenas
+            update_enemy_fire();        // Tiros dos alienígenas
+            PROFILE_END(PHASE_ALIENS);
+            PROFILE_BEGIN(PHASE_COLLISIONS);
+            check_collisions();         // Verifica colisões dos projéteis
+            check_player_collision();   // Verifica colisão jogador-alienígena
+            finish_frame();             // Fim da partida ou próxima onda
+            PROFILE_END(PHASE_COLLISIONS);
+        }
+
+        // Fim de partida: a gravação termina e vai para o disco no fim do quadro
+        if (game.game_state != GAME_STATE_PLAYING)
         {
-            next_wave();
+            if (replay_mode == REPLAY_RECORDING)
+                replay_finish_recording();
+            replay_mode = REPLAY_IDLE;
         }
         break;
     }
     }
-}
\ No newline at end of file
+}
+
+/**
+ * Avança os efeitos de um quadro exibido: o sequenciador, os eventos que a
+ * simulação registrou desde o quadro anterior e as explosões. Roda uma vez
+ * por quadro desenhado, então os quadros extras do avanço rápido não
+ * reiniciam os sons.
+ */
+void update_effects()
+{
+    // Antes dos eventos, para que um som iniciado neste quadro dure o tempo todo
+    PROFILE_BEGIN(PHASE_AUDIO);
+    seq_update();
+    PROFILE_END(PHASE_AUDIO);
+    PROFILE_BEGIN(PHASE_EVENTS);
+    dispatch_events();
+    PROFILE_END(PHASE_EVENTS);
+    PROFILE_BEGIN(PHASE_EXPLOSIONS);
+    update_explosions();
+    PROFILE_END(PHASE_EXPLOSIONS);
+}
+
+/**
+ * Desenha o estado atual do jogo. Só lê o estado da simulação; o que muda
+ * aqui é apenas visual (estrelas, tremores e os caches de desenho).
+ */
+void render_frame()
+{
+    if (game.game_state == GAME_STATE_PLAYING)
+    {
+        draw_playfield();
+        return;
+    }
+
+    // Com o framebuffer preservado, o menu limpa a tela por conta própria
+    if (dirty_rendering)
+    {
+        uint32_t all[TILE_COUNT];
+        for (int row = 0; row < TILE_COUNT; ++row)
+            all[row] = TILE_ROW_FULL;
+        clear_tiles(all);
+        render_full = TRUE;
+    }
+    PROFILE_BEGIN(PHASE_STARS);
+    draw_background_stars();
+    PROFILE_END(PHASE_STARS);
+    PROFILE_BEGIN(PHASE_MENU);
+    draw_menu();
+    PROFILE_END(PHASE_MENU);
+}
+
+/**
+ * Função principal de atualização do jogo.
+ * É chamada 60 vezes por segundo pelo WASM-4.
+ * Simula o quadro e depois desenha o estado resultante.
+ */
+void update()
+{
+    simulate_frame(read_frame_input());
+
+    // Segurar a seta para a direita acelera a reprodução: só o último dos
+    // quadros simulados é desenhado
+    if (replay_mode == REPLAY_PLAYING && (*GAMEPAD1 & BUTTON_RIGHT))
+    {
+        for (int i = 1; i < REPLAY_FAST_FORWARD && replay_mode == REPLAY_PLAYING; ++i)
+            simulate_frame(read_frame_input());
+    }
+
+    update_effects();
+    update_quality();
+    render_frame();
+    save_tick();
+    STACK_CHECK();
+    PROFILE_FRAME_END();
+}
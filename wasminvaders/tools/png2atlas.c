@@ -0,0 +1,593 @@
+/**
+ * png2atlas.c - Empacota os sprites PNG do jogo em um único atlas 2bpp.
+ *
+ * Lê um manifesto (assets/atlas.txt) com uma linha por folha de sprites:
+ *
+ *     nome  arquivo.png  largura_do_quadro
+ *
+ * Cada folha é um PNG indexado com no máximo 4 cores, com os quadros lado a
+ * lado e da mesma largura. As folhas são colocadas em prateleiras de um atlas
+ * de largura fixa, na ordem do manifesto, sempre começando em um x múltiplo de
+ * 4 (um byte em 2bpp). O resultado é um header C com o atlas no formato do
+ * blit() do WASM-4 (pixel mais à esquerda nos bits mais altos) e, para cada
+ * folha, as constantes ATLAS_<NOME>_X, _Y, _WIDTH, _HEIGHT e _FRAMES.
+ *
+ * O índice da paleta do PNG é o índice de cor do sprite: com DRAW_COLORS a
+ * cor 0 costuma ser transparente e as cores 1..3 viram as cores da paleta.
+ *
+ * Uso: png2atlas [-w largura] -o saida.h manifesto.txt
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_SHEETS 32
+#define MAX_NAME 32
+
+typedef struct
+{
+    char name[MAX_NAME];
+    int frame_width, frames;
+    int width, height;
+    uint8_t *pixels; // Um índice de cor (0..3) por pixel
+    int x, y;        // Posição no atlas
+} Sheet;
+
+static void fail(const char *message, const char *detail)
+{
+    fprintf(stderr, "png2atlas: %s%s%s\n", message, detail ? ": " : "", detail ? detail : "");
+    exit(1);
+}
+
+// --- Deflate (RFC 1951), somente descompressão ---
+
+typedef struct
+{
+    const uint8_t *in;
+    size_t in_size, in_pos;
+    uint32_t bit_buffer;
+    int bit_count;
+    uint8_t *out;
+    size_t out_size, out_capacity;
+} Inflate;
+
+typedef struct
+{
+    short count[16];   // Códigos de cada comprimento
+    short symbol[320]; // Símbolos em ordem canônica
+} Huffman;
+
+static int inflate_bits(Inflate *s, int need)
+{
+    uint32_t value = s->bit_buffer;
+    while (s->bit_count < need)
+    {
+        if (s->in_pos >= s->in_size)
+            fail("dados compactados truncados", NULL);
+        value |= (uint32_t)s->in[s->in_pos++] << s->bit_count;
+        s->bit_count += 8;
+    }
+    s->bit_buffer = value >> need;
+    s->bit_count -= need;
+    return (int)(value & ((1u << need) - 1));
+}
+
+static void inflate_put(Inflate *s, uint8_t byte)
+{
+    if (s->out_size == s->out_capacity)
+    {
+        s->out_capacity = s->out_capacity ? s->out_capacity * 2 : 4096;
+        s->out = realloc(s->out, s->out_capacity);
+        if (!s->out)
+            fail("sem memória", NULL);
+    }
+    s->out[s->out_size++] = byte;
+}
+
+static void inflate_stored(Inflate *s)
+{
+    s->bit_buffer = 0;
+    s->bit_count = 0;
+    if (s->in_pos + 4 > s->in_size)
+        fail("bloco sem compressão truncado", NULL);
+    unsigned length = s->in[s->in_pos] | (unsigned)s->in[s->in_pos + 1] << 8;
+    unsigned check = s->in[s->in_pos + 2] | (unsigned)s->in[s->in_pos + 3] << 8;
+    s->in_pos += 4;
+    if (length != (~check & 0xffffu) || s->in_pos + length > s->in_size)
+        fail("bloco sem compressão inválido", NULL);
+    while (length--)
+        inflate_put(s, s->in[s->in_pos++]);
+}
+
+static int huffman_build(Huffman *h, const short *lengths, int n)
+{
+    short offsets[16];
+    memset(h->count, 0, sizeof(h->count));
+    for (int i = 0; i < n; ++i)
+        h->count[lengths[i]]++;
+    if (h->count[0] == n)
+        return 0;
+
+    int left = 1;
+    for (int len = 1; len < 16; ++len)
+    {
+        left <<= 1;
+        left -= h->count[len];
+        if (left < 0)
+            return left;
+    }
+
+    offsets[1] = 0;
+    for (int len = 1; len < 15; ++len)
+        offsets[len + 1] = (short)(offsets[len] + h->count[len]);
+    for (int i = 0; i < n; ++i)
+        if (lengths[i] != 0)
+            h->symbol[offsets[lengths[i]]++] = (short)i;
+    return left;
+}
+
+static int huffman_decode(Inflate *s, const Huffman *h)
+{
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len < 16; ++len)
+    {
+        code |= inflate_bits(s, 1);
+        int count = h->count[len];
+        if (code - count < first)
+            return h->symbol[index + (code - first)];
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    fail("código de Huffman inválido", NULL);
+    return -1;
+}
+
+static void inflate_codes(Inflate *s, const Huffman *lengths, const Huffman *distances)
+{
+    static const short length_base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                          35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const short length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                           3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const short distance_base[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                            193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+                                            6145, 8193, 12289, 16385, 24577};
+    static const short distance_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                             6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    for (;;)
+    {
+        int symbol = huffman_decode(s, lengths);
+        if (symbol < 256)
+        {
+            inflate_put(s, (uint8_t)symbol);
+            continue;
+        }
+        if (symbol == 256)
+            return;
+
+        symbol -= 257;
+        if (symbol >= 29)
+            fail("comprimento inválido", NULL);
+        int length = length_base[symbol] + inflate_bits(s, length_extra[symbol]);
+
+        symbol = huffman_decode(s, distances);
+        if (symbol >= 30)
+            fail("distância inválida", NULL);
+        size_t distance = (size_t)(distance_base[symbol] + inflate_bits(s, distance_extra[symbol]));
+        if (distance > s->out_size)
+            fail("distância antes do início dos dados", NULL);
+        while (length--)
+            inflate_put(s, s->out[s->out_size - distance]);
+    }
+}
+
+static void inflate_fixed(Inflate *s)
+{
+    static Huffman lengths, distances;
+    static int built = 0;
+    if (!built)
+    {
+        short table[288];
+        int i = 0;
+        for (; i < 144; ++i)
+            table[i] = 8;
+        for (; i < 256; ++i)
+            table[i] = 9;
+        for (; i < 280; ++i)
+            table[i] = 7;
+        for (; i < 288; ++i)
+            table[i] = 8;
+        huffman_build(&lengths, table, 288);
+        for (i = 0; i < 30; ++i)
+            table[i] = 5;
+        huffman_build(&distances, table, 30);
+        built = 1;
+    }
+    inflate_codes(s, &lengths, &distances);
+}
+
+static void inflate_dynamic(Inflate *s)
+{
+    static const short order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+    short table[320];
+    Huffman lengths, distances;
+
+    int literal_count = inflate_bits(s, 5) + 257;
+    int distance_count = inflate_bits(s, 5) + 1;
+    int code_count = inflate_bits(s, 4) + 4;
+    if (literal_count > 286 || distance_count > 30)
+        fail("cabeçalho de bloco dinâmico inválido", NULL);
+
+    int index = 0;
+    for (; index < code_count; ++index)
+        table[order[index]] = (short)inflate_bits(s, 3);
+    for (; index < 19; ++index)
+        table[order[index]] = 0;
+    if (huffman_build(&lengths, table, 19) != 0)
+        fail("código de comprimentos incompleto", NULL);
+
+    index = 0;
+    while (index < literal_count + distance_count)
+    {
+        int symbol = huffman_decode(s, &lengths);
+        if (symbol < 16)
+        {
+            table[index++] = (short)symbol;
+            continue;
+        }
+        short value = 0;
+        int repeat;
+        if (symbol == 16)
+        {
+            if (index == 0)
+                fail("repetição sem comprimento anterior", NULL);
+            value = table[index - 1];
+            repeat = 3 + inflate_bits(s, 2);
+        }
+        else if (symbol == 17)
+        {
+            repeat = 3 + inflate_bits(s, 3);
+        }
+        else
+        {
+            repeat = 11 + inflate_bits(s, 7);
+        }
+        if (index + repeat > literal_count + distance_count)
+            fail("comprimentos demais no bloco dinâmico", NULL);
+        while (repeat--)
+            table[index++] = value;
+    }
+    if (table[256] == 0)
+        fail("bloco dinâmico sem código de fim", NULL);
+
+    int err = huffman_build(&lengths, table, literal_count);
+    if (err < 0 || (err > 0 && literal_count - lengths.count[0] != 1))
+        fail("código de literais inválido", NULL);
+    err = huffman_build(&distances, table + literal_count, distance_count);
+    if (err < 0 || (err > 0 && distance_count - distances.count[0] != 1))
+        fail("código de distâncias inválido", NULL);
+
+    inflate_codes(s, &lengths, &distances);
+}
+
+static uint8_t *zlib_decompress(const uint8_t *data, size_t size, size_t *out_size)
+{
+    if (size < 2 || (data[0] & 0x0f) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20))
+        fail("fluxo zlib inválido", NULL);
+
+    Inflate s = {.in = data, .in_size = size, .in_pos = 2};
+    int last;
+    do
+    {
+        last = inflate_bits(&s, 1);
+        int type = inflate_bits(&s, 2);
+        if (type == 0)
+            inflate_stored(&s);
+        else if (type == 1)
+            inflate_fixed(&s);
+        else if (type == 2)
+            inflate_dynamic(&s);
+        else
+            fail("tipo de bloco inválido", NULL);
+    } while (!last);
+
+    *out_size = s.out_size;
+    return s.out;
+}
+
+// --- PNG ---
+
+static uint32_t read_be32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint8_t *read_file(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        fail("não foi possível abrir", path);
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = malloc(length > 0 ? (size_t)length : 1);
+    if (!data || fread(data, 1, (size_t)length, file) != (size_t)length)
+        fail("falha ao ler", path);
+    fclose(file);
+    *size = (size_t)length;
+    return data;
+}
+
+static int paeth(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc)
+        return a;
+    return pb <= pc ? b : c;
+}
+
+/**
+ * Decodifica um PNG indexado (profundidade 1, 2, 4 ou 8, sem entrelaçamento)
+ * e retorna um índice de paleta por pixel.
+ */
+static uint8_t *load_indexed_png(const char *path, int *width, int *height)
+{
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    size_t size;
+    uint8_t *file = read_file(path, &size);
+    if (size < 8 || memcmp(file, signature, 8) != 0)
+        fail("não é um PNG", path);
+
+    uint8_t *idat = NULL;
+    size_t idat_size = 0;
+    int depth = 0, color_type = -1, interlace = 0;
+    *width = *height = 0;
+
+    for (size_t pos = 8; pos + 12 <= size;)
+    {
+        uint32_t length = read_be32(file + pos);
+        const uint8_t *type = file + pos + 4;
+        const uint8_t *body = file + pos + 8;
+        if (pos + 12 + length > size)
+            fail("bloco truncado", path);
+
+        if (!memcmp(type, "IHDR", 4) && length >= 13)
+        {
+            *width = (int)read_be32(body);
+            *height = (int)read_be32(body + 4);
+            depth = body[8];
+            color_type = body[9];
+            interlace = body[12];
+        }
+        else if (!memcmp(type, "IDAT", 4))
+        {
+            idat = realloc(idat, idat_size + length);
+            if (!idat)
+                fail("sem memória", NULL);
+            memcpy(idat + idat_size, body, length);
+            idat_size += length;
+        }
+        else if (!memcmp(type, "IEND", 4))
+        {
+            break;
+        }
+        pos += 12 + length;
+    }
+
+    if (color_type != 3 || (depth != 1 && depth != 2 && depth != 4 && depth != 8))
+        fail("o PNG precisa ser indexado (paleta de até 4 cores)", path);
+    if (interlace != 0)
+        fail("PNG entrelaçado não é suportado", path);
+    if (*width <= 0 || *height <= 0 || !idat)
+        fail("PNG sem imagem", path);
+
+    size_t raw_size;
+    uint8_t *raw = zlib_decompress(idat, idat_size, &raw_size);
+    size_t row_bytes = ((size_t)*width * (size_t)depth + 7) / 8;
+    if (raw_size < (row_bytes + 1) * (size_t)*height)
+        fail("dados da imagem truncados", path);
+
+    // Desfaz os filtros de cada linha (bytes por pixel = 1 em imagens indexadas)
+    uint8_t *previous = calloc(row_bytes, 1);
+    for (int y = 0; y < *height; ++y)
+    {
+        uint8_t *row = raw + (size_t)y * (row_bytes + 1);
+        uint8_t filter = row[0];
+        uint8_t *line = row + 1;
+        for (size_t i = 0; i < row_bytes; ++i)
+        {
+            int a = i > 0 ? line[i - 1] : 0, b = previous[i], c = i > 0 ? previous[i - 1] : 0;
+            switch (filter)
+            {
+            case 0:
+                break;
+            case 1:
+                line[i] = (uint8_t)(line[i] + a);
+                break;
+            case 2:
+                line[i] = (uint8_t)(line[i] + b);
+                break;
+            case 3:
+                line[i] = (uint8_t)(line[i] + ((a + b) >> 1));
+                break;
+            case 4:
+                line[i] = (uint8_t)(line[i] + paeth(a, b, c));
+                break;
+            default:
+                fail("filtro de linha inválido", path);
+            }
+        }
+        memcpy(previous, line, row_bytes);
+    }
+
+    uint8_t *pixels = malloc((size_t)*width * (size_t)*height);
+    for (int y = 0; y < *height; ++y)
+    {
+        const uint8_t *line = raw + (size_t)y * (row_bytes + 1) + 1;
+        for (int x = 0; x < *width; ++x)
+        {
+            int bit = x * depth;
+            int index = (line[bit >> 3] >> (8 - depth - (bit & 7))) & ((1 << depth) - 1);
+            if (index > 3)
+                fail("o PNG usa mais de 4 cores da paleta", path);
+            pixels[y * *width + x] = (uint8_t)index;
+        }
+    }
+
+    free(previous);
+    free(raw);
+    free(idat);
+    free(file);
+    return pixels;
+}
+
+// --- Atlas ---
+
+static int load_manifest(const char *path, Sheet *sheets)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+        fail("não foi possível abrir", path);
+
+    // Os arquivos do manifesto são relativos à pasta dele
+    char directory[512] = "";
+    const char *slash = strrchr(path, '/');
+    if (slash && (size_t)(slash - path) + 1 < sizeof(directory))
+        memcpy(directory, path, (size_t)(slash - path) + 1);
+
+    int count = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), file))
+    {
+        char name[MAX_NAME], file_name[256];
+        int frame_width;
+        if (line[0] == '#' || sscanf(line, "%31s %255s %d", name, file_name, &frame_width) != 3)
+            continue;
+        if (count == MAX_SHEETS)
+            fail("folhas demais no manifesto", path);
+
+        Sheet *sheet = &sheets[count++];
+        memset(sheet, 0, sizeof(*sheet));
+        snprintf(sheet->name, sizeof(sheet->name), "%s", name);
+        char full_path[800];
+        snprintf(full_path, sizeof(full_path), "%s%s", directory, file_name);
+        sheet->pixels = load_indexed_png(full_path, &sheet->width, &sheet->height);
+        if (frame_width <= 0 || sheet->width % frame_width != 0)
+            fail("a largura da folha não é múltipla da largura do quadro", full_path);
+        sheet->frame_width = frame_width;
+        sheet->frames = sheet->width / frame_width;
+    }
+    fclose(file);
+    return count;
+}
+
+// Coloca as folhas em prateleiras, na ordem do manifesto; retorna a altura do atlas
+static int pack_sheets(Sheet *sheets, int count, int atlas_width)
+{
+    int x = 0, y = 0, shelf_height = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        Sheet *sheet = &sheets[i];
+        if (sheet->width > atlas_width)
+            fail("folha mais larga que o atlas", sheet->name);
+        if (x + sheet->width > atlas_width)
+        {
+            x = 0;
+            y += shelf_height;
+            shelf_height = 0;
+        }
+        sheet->x = x;
+        sheet->y = y;
+        x = (x + sheet->width + 3) & ~3;
+        if (sheet->height > shelf_height)
+            shelf_height = sheet->height;
+    }
+    return y + shelf_height;
+}
+
+static void write_header(const char *path, const char *manifest, Sheet *sheets, int count,
+                         int atlas_width, int atlas_height)
+{
+    int stride = atlas_width / 4;
+    size_t size = (size_t)stride * (size_t)atlas_height;
+    uint8_t *atlas = calloc(size ? size : 1, 1);
+    for (int i = 0; i < count; ++i)
+    {
+        const Sheet *sheet = &sheets[i];
+        for (int y = 0; y < sheet->height; ++y)
+        {
+            for (int x = 0; x < sheet->width; ++x)
+            {
+                int ax = sheet->x + x, ay = sheet->y + y;
+                uint8_t color = sheet->pixels[y * sheet->width + x];
+                atlas[ay * stride + (ax >> 2)] |= (uint8_t)(color << (6 - ((ax & 3) << 1)));
+            }
+        }
+    }
+
+    FILE *out = fopen(path, "w");
+    if (!out)
+        fail("não foi possível criar", path);
+    fprintf(out, "// Gerado por tools/png2atlas.c a partir de %s. Não edite: rode `make atlas`.\n\n", manifest);
+    fprintf(out, "#pragma once\n\n");
+    fprintf(out, "#define ATLAS_WIDTH %d\n", atlas_width);
+    fprintf(out, "#define ATLAS_HEIGHT %d\n", atlas_height);
+    fprintf(out, "#define ATLAS_FLAGS BLIT_2BPP\n");
+    for (int i = 0; i < count; ++i)
+    {
+        const Sheet *sheet = &sheets[i];
+        char upper[MAX_NAME];
+        size_t n = 0;
+        for (; sheet->name[n]; ++n)
+        {
+            char c = sheet->name[n];
+            upper[n] = (char)(c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c);
+        }
+        upper[n] = '\0';
+        fprintf(out, "\n#define ATLAS_%s_X %d\n", upper, sheet->x);
+        fprintf(out, "#define ATLAS_%s_Y %d\n", upper, sheet->y);
+        fprintf(out, "#define ATLAS_%s_WIDTH %d\n", upper, sheet->frame_width);
+        fprintf(out, "#define ATLAS_%s_HEIGHT %d\n", upper, sheet->height);
+        fprintf(out, "#define ATLAS_%s_FRAMES %d\n", upper, sheet->frames);
+    }
+
+    fprintf(out, "\nconst uint8_t atlas[%zu] = {", size);
+    for (size_t i = 0; i < size; ++i)
+        fprintf(out, "%s0x%02x,", i % 16 ? " " : "\n    ", atlas[i]);
+    fprintf(out, "\n};\n");
+    fclose(out);
+    free(atlas);
+}
+
+int main(int argc, char **argv)
+{
+    const char *output = NULL, *manifest = NULL;
+    int atlas_width = 64;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc)
+            output = argv[++i];
+        else if (!strcmp(argv[i], "-w") && i + 1 < argc)
+            atlas_width = atoi(argv[++i]);
+        else
+            manifest = argv[i];
+    }
+    if (!output || !manifest || atlas_width <= 0 || atlas_width % 4 != 0)
+    {
+        fprintf(stderr, "usage: %s [-w width] -o atlas.h manifest.txt\n", argv[0]);
+        return 2;
+    }
+
+    Sheet sheets[MAX_SHEETS];
+    int count = load_manifest(manifest, sheets);
+    int atlas_height = pack_sheets(sheets, count, atlas_width);
+    write_header(output, manifest, sheets, count, atlas_width, atlas_height);
+
+    for (int i = 0; i < count; ++i)
+        free(sheets[i].pixels);
+    return 0;
+}
@@ -0,0 +1,639 @@
+/**
+ * wasmmap.c - Mostra como o cartucho ocupa os 64 KB de memória do WASM-4.
+ *
+ * Lê um .wasm ligado sem --strip-all (com a seção "name") e informa:
+ *
+ *   - o tamanho de cada seção do arquivo;
+ *   - o mapa da memória linear: registradores e framebuffer, pilha, dados
+ *     inicializados, dados zerados (bss) e o que sobra livre até 64 KB;
+ *   - o código de cada função, do maior para o menor, com o quadro de pilha
+ *     que o prólogo reserva (global.get $__stack_pointer; i32.const N; i32.sub).
+ *
+ * O topo da pilha vem do valor inicial de __stack_pointer e o fim dos dados
+ * do global exportado __heap_base (ou __data_end). O pico real da pilha só é
+ * conhecido em execução: o build DEBUG=1 informa no console do w4.
+ *
+ * Com -w, grava em vez disso uma linha de base com o tamanho do cartucho sem
+ * as seções custom (o que --strip-all deixaria) e os bytes de cada função;
+ * com -b, compara o arquivo com uma linha de base gravada antes e mostra as
+ * funções que mais mudaram. Com -t, -b termina com erro se o tamanho sem
+ * seções custom cresceu mais que a tolerância (em bytes).
+ *
+ * Uso: wasmmap [-n funções] [-w saída | -b base [-t tolerância]] cart.wasm
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEMORY_SIZE 65536      // Memória fixa do WASM-4
+#define FRAMEBUFFER_END 0x19a0 // Registradores (0x00-0x9f) e framebuffer (0xa0-0x199f)
+#define MAX_GLOBALS 64
+#define MAX_SEGMENTS 64
+#define MAX_LABEL 256 // Nome de função na linha de base
+
+typedef struct
+{
+    uint32_t index;   // Índice da função (importadas vêm primeiro)
+    size_t body;      // Posição do corpo no arquivo
+    uint32_t size;    // Bytes do corpo na seção de código
+    uint32_t frame;   // Bytes de pilha reservados no prólogo (0 = nenhum)
+    const char *name; // Da seção "name", ou NULL
+    uint32_t name_size;
+} Function;
+
+typedef struct
+{
+    int active;       // Segmento com endereço fixo (os passivos são copiados em código)
+    uint32_t offset;  // Endereço na memória linear
+    uint32_t size;    // Bytes no arquivo
+    const char *name; // Da seção "name" (.data, .rodata, .bss...), ou NULL
+    uint32_t name_size;
+} Segment;
+
+typedef struct
+{
+    const uint8_t *data;
+    size_t size, pos;
+} Reader;
+
+static void fail(const char *message, const char *detail)
+{
+    fprintf(stderr, "wasmmap: %s%s%s\n", message, detail ? ": " : "", detail ? detail : "");
+    exit(1);
+}
+
+// --- Leitura do binário ---
+
+static uint8_t read_byte(Reader *r)
+{
+    if (r->pos >= r->size)
+        fail("arquivo truncado", NULL);
+    return r->data[r->pos++];
+}
+
+static uint32_t read_uleb(Reader *r)
+{
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        uint8_t byte = read_byte(r);
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+    fail("LEB128 inválido", NULL);
+    return 0;
+}
+
+static int32_t read_sleb(Reader *r)
+{
+    uint32_t value = 0;
+    int shift = 0;
+    uint8_t byte;
+    do
+    {
+        byte = read_byte(r);
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while ((byte & 0x80) && shift < 35);
+    if (shift < 32 && (byte & 0x40))
+        value |= ~0u << shift;
+    return (int32_t)value;
+}
+
+static const char *read_name(Reader *r, uint32_t *size)
+{
+    *size = read_uleb(r);
+    if (*size > r->size - r->pos)
+        fail("nome truncado", NULL);
+    const char *name = (const char *)r->data + r->pos;
+    r->pos += *size;
+    return name;
+}
+
+// Lê uma expressão constante; retorna o valor se for i32.const, senão -1
+static int64_t read_const_expr(Reader *r)
+{
+    int64_t value = -1;
+    for (;;)
+    {
+        uint8_t op = read_byte(r);
+        if (op == 0x0b) // end
+            return value;
+        if (op == 0x41) // i32.const
+            value = read_sleb(r);
+        else if (op == 0x23) // global.get
+            read_uleb(r);
+        else
+            fail("expressão constante não suportada", NULL);
+    }
+}
+
+static uint8_t *read_file(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        fail("não foi possível abrir", path);
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = malloc(length > 0 ? (size_t)length : 1);
+    if (!data || fread(data, 1, (size_t)length, file) != (size_t)length)
+        fail("falha ao ler", path);
+    fclose(file);
+    *size = (size_t)length;
+    return data;
+}
+
+/**
+ * Procura no começo do corpo de uma função o prólogo que abre o quadro de
+ * pilha: global.get $sp, i32.const N, i32.sub. Retorna N ou 0.
+ */
+static uint32_t stack_frame_size(const uint8_t *body, size_t size, uint32_t stack_pointer)
+{
+    Reader r = {body, size, 0};
+    uint32_t groups = read_uleb(&r); // Declarações de locais
+    for (uint32_t i = 0; i < groups; ++i)
+    {
+        read_uleb(&r);
+        read_byte(&r);
+    }
+    size_t limit = r.pos + 16 < size ? r.pos + 16 : size;
+    for (size_t p = r.pos; p + 3 < limit; ++p)
+    {
+        if (body[p] != 0x23) // global.get
+            continue;
+        Reader g = {body, size, p + 1};
+        if (read_uleb(&g) != stack_pointer)
+            continue;
+        if (g.pos < size && body[g.pos] == 0x41) // i32.const
+        {
+            g.pos++;
+            int32_t frame = read_sleb(&g);
+            if (g.pos < size && body[g.pos] == 0x6b && frame > 0) // i32.sub
+                return (uint32_t)frame;
+        }
+        return 0;
+    }
+    return 0;
+}
+
+static int compare_functions(const void *a, const void *b)
+{
+    const Function *x = a, *y = b;
+    return (x->size < y->size) - (x->size > y->size);
+}
+
+static int name_is(const char *name, uint32_t size, const char *expected)
+{
+    return name && size == strlen(expected) && !memcmp(name, expected, size);
+}
+
+// Nome da função na linha de base: o da seção "name" ou function[índice]
+static void function_label(const Function *f, char *out, size_t size)
+{
+    if (f->name)
+        snprintf(out, size, "%.*s", (int)f->name_size, f->name);
+    else
+        snprintf(out, size, "function[%u]", f->index);
+}
+
+// --- Linha de base de tamanho ---
+
+typedef struct
+{
+    char name[MAX_LABEL];
+    int64_t before, after; // Bytes na linha de base e agora (-1 = não existe)
+} SizeChange;
+
+static int compare_changes(const void *a, const void *b)
+{
+    const SizeChange *x = a, *y = b;
+    int64_t dx = (x->after >= 0 ? x->after : 0) - (x->before >= 0 ? x->before : 0);
+    int64_t dy = (y->after >= 0 ? y->after : 0) - (y->before >= 0 ? y->before : 0);
+    dx = dx < 0 ? -dx : dx;
+    dy = dy < 0 ? -dy : dy;
+    return (dx < dy) - (dx > dy);
+}
+
+static void write_baseline(const char *path, size_t stripped, uint32_t code_total, const Function *functions,
+                           uint32_t function_count)
+{
+    FILE *out = fopen(path, "w");
+    if (!out)
+        fail("não foi possível gravar", path);
+    fprintf(out, "stripped %zu\ncode %u\n", stripped, code_total);
+    for (uint32_t i = 0; i < function_count; ++i)
+    {
+        char label[MAX_LABEL];
+        function_label(&functions[i], label, sizeof(label));
+        fprintf(out, "%u %s\n", functions[i].size, label);
+    }
+    if (fclose(out) != 0)
+        fail("não foi possível gravar", path);
+    printf("%s: stripped %zu bytes, code %u bytes in %u functions\n", path, stripped, code_total, function_count);
+}
+
+/**
+ * Compara com a linha de base em path e lista as show funções que mais mudaram
+ * (show <= 0 lista todas). Retorna 1 se o tamanho sem seções custom cresceu
+ * mais que tolerance bytes (tolerance < 0 nunca falha).
+ */
+static int compare_baseline(const char *path, size_t stripped, uint32_t code_total, const Function *functions,
+                            uint32_t function_count, int show, long tolerance)
+{
+    FILE *in = fopen(path, "r");
+    if (!in)
+        fail("linha de base não encontrada (make sizebaseline)", path);
+
+    uint32_t change_count = function_count, capacity = function_count + 1;
+    SizeChange *changes = calloc(capacity, sizeof(SizeChange));
+    for (uint32_t i = 0; i < function_count; ++i)
+    {
+        function_label(&functions[i], changes[i].name, MAX_LABEL);
+        changes[i].before = -1;
+        changes[i].after = functions[i].size;
+    }
+
+    int64_t base_stripped = -1, base_code = -1;
+    uint32_t base_functions = 0;
+    char line[MAX_LABEL + 32], name[MAX_LABEL];
+    while (fgets(line, sizeof(line), in))
+    {
+        long long value;
+        if (sscanf(line, "stripped %lld", &value) == 1)
+            base_stripped = value;
+        else if (sscanf(line, "code %lld", &value) == 1)
+            base_code = value;
+        else if (sscanf(line, "%lld %255s", &value, name) == 2)
+        {
+            base_functions++;
+            uint32_t i = 0;
+            while (i < change_count && (changes[i].before >= 0 || strcmp(changes[i].name, name) != 0))
+                ++i;
+            if (i == change_count)
+            {
+                if (change_count == capacity)
+                    changes = realloc(changes, (capacity *= 2) * sizeof(SizeChange));
+                memset(&changes[i], 0, sizeof(SizeChange));
+                snprintf(changes[i].name, MAX_LABEL, "%s", name);
+                changes[i].after = -1;
+                change_count++;
+            }
+            changes[i].before = value;
+        }
+    }
+    fclose(in);
+    if (base_stripped < 0 || base_code < 0)
+        fail("linha de base inválida", path);
+
+    printf("size vs %s:\n", path);
+    printf("  %-10s %6lld -> %6zu  %+lld\n", "stripped", (long long)base_stripped, stripped,
+           (long long)stripped - (long long)base_stripped);
+    printf("  %-10s %6lld -> %6u  %+lld  (%u functions, was %u)\n\n", "code", (long long)base_code, code_total,
+           (long long)code_total - (long long)base_code, function_count, base_functions);
+
+    // Só as funções que mudaram, da maior diferença para a menor
+    uint32_t changed = 0;
+    for (uint32_t i = 0; i < change_count; ++i)
+    {
+        if (changes[i].before != changes[i].after)
+            changes[changed++] = changes[i];
+    }
+    qsort(changes, changed, sizeof(SizeChange), compare_changes);
+    printf("function changes: %u\n", changed);
+    if (changed)
+        printf("  %6s %6s %6s  %s\n", "before", "after", "delta", "function");
+    for (uint32_t i = 0; i < changed && (show <= 0 || i < (uint32_t)show); ++i)
+    {
+        const SizeChange *c = &changes[i];
+        char before[24] = "-", after[24] = "-";
+        if (c->before >= 0)
+            snprintf(before, sizeof(before), "%lld", (long long)c->before);
+        if (c->after >= 0)
+            snprintf(after, sizeof(after), "%lld", (long long)c->after);
+        printf("  %6s %6s %+6lld  %s\n", before, after,
+               (long long)((c->after >= 0 ? c->after : 0) - (c->before >= 0 ? c->before : 0)), c->name);
+    }
+    if (show > 0 && changed > (uint32_t)show)
+        printf("  ... %u more (-n 0 lists all)\n", changed - (uint32_t)show);
+    free(changes);
+
+    long long growth = (long long)stripped - (long long)base_stripped;
+    if (tolerance >= 0 && growth > tolerance)
+    {
+        printf("\nsize check failed: stripped cart grew %lld bytes (tolerance %ld)\n", growth, tolerance);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL, *baseline_out = NULL, *baseline_in = NULL;
+    int show = 25;
+    long tolerance = -1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            show = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-w") && i + 1 < argc)
+            baseline_out = argv[++i];
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc)
+            baseline_in = argv[++i];
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+            tolerance = strtol(argv[++i], NULL, 0);
+        else if (!path)
+            path = argv[i];
+        else
+            path = NULL, i = argc;
+    }
+    if (!path || (baseline_out && baseline_in))
+    {
+        fprintf(stderr, "usage: wasmmap [-n functions] [-w baseline | -b baseline [-t tolerance]] cart.wasm\n");
+        return 2;
+    }
+
+    size_t file_size;
+    uint8_t *file = read_file(path, &file_size);
+    Reader r = {file, file_size, 0};
+    if (file_size < 8 || memcmp(file, "\0asm", 4) != 0)
+        fail("não é um módulo wasm", path);
+    r.pos = 8;
+
+    static const char *section_names[] = {"custom", "type", "import", "function", "table", "memory", "global",
+                                          "export", "start", "element", "code", "data", "datacount"};
+    uint32_t section_size[13] = {0};
+
+    uint32_t imported_functions = 0, imported_globals = 0;
+    Function *functions = NULL;
+    uint32_t function_count = 0;
+    int64_t global_value[MAX_GLOBALS];
+    int global_mutable[MAX_GLOBALS];
+    uint32_t global_count = 0;
+    int64_t heap_base = -1, data_end = -1;
+    Segment segments[MAX_SEGMENTS];
+    uint32_t segment_count = 0;
+    int64_t stack_pointer = -1; // Índice de __stack_pointer, se nomeado
+    int have_code = 0;
+    size_t stripped = file_size; // Sem as seções custom, como depois de --strip-all
+
+    while (r.pos < file_size)
+    {
+        size_t section_start = r.pos;
+        uint8_t id = read_byte(&r);
+        uint32_t size = read_uleb(&r);
+        if (size > file_size - r.pos)
+            fail("seção truncada", NULL);
+        Reader s = {file, r.pos + size, r.pos};
+        r.pos += size;
+        if (id < 13)
+            section_size[id] += size;
+        if (id == 0)
+            stripped -= r.pos - section_start;
+
+        if (id == 2) // import
+        {
+            for (uint32_t count = read_uleb(&s); count > 0; --count)
+            {
+                uint32_t length;
+                read_name(&s, &length);
+                read_name(&s, &length);
+                uint8_t kind = read_byte(&s);
+                if (kind == 0)
+                {
+                    read_uleb(&s);
+                    imported_functions++;
+                }
+                else if (kind == 1) // table
+                {
+                    read_byte(&s);
+                    if (read_byte(&s) & 1)
+                        read_uleb(&s);
+                    read_uleb(&s);
+                }
+                else if (kind == 2) // memory
+                {
+                    if (read_byte(&s) & 1)
+                        read_uleb(&s);
+                    read_uleb(&s);
+                }
+                else // global
+                {
+                    read_byte(&s);
+                    read_byte(&s);
+                    if (imported_globals < MAX_GLOBALS)
+                        global_value[imported_globals] = -1, global_mutable[imported_globals] = 0;
+                    imported_globals++;
+                }
+            }
+            global_count = imported_globals;
+        }
+        else if (id == 3) // function
+        {
+            function_count = read_uleb(&s);
+            functions = calloc(function_count ? function_count : 1, sizeof(Function));
+            for (uint32_t i = 0; i < function_count; ++i)
+            {
+                read_uleb(&s);
+                functions[i].index = imported_functions + i;
+            }
+        }
+        else if (id == 6) // global
+        {
+            for (uint32_t count = read_uleb(&s); count > 0; --count)
+            {
+                read_byte(&s);
+                int mutable = read_byte(&s);
+                int64_t value = read_const_expr(&s);
+                if (global_count < MAX_GLOBALS)
+                {
+                    global_value[global_count] = value;
+                    global_mutable[global_count] = mutable;
+                }
+                global_count++;
+            }
+        }
+        else if (id == 7) // export
+        {
+            for (uint32_t count = read_uleb(&s); count > 0; --count)
+            {
+                uint32_t length;
+                const char *name = read_name(&s, &length);
+                uint8_t kind = read_byte(&s);
+                uint32_t index = read_uleb(&s);
+                if (kind != 3 || index >= global_count || index >= MAX_GLOBALS)
+                    continue;
+                if (name_is(name, length, "__heap_base"))
+                    heap_base = global_value[index];
+                else if (name_is(name, length, "__data_end"))
+                    data_end = global_value[index];
+            }
+        }
+        else if (id == 10) // code
+        {
+            have_code = 1;
+            uint32_t count = read_uleb(&s);
+            if (count != function_count)
+                fail("seções de funções e de código não batem", NULL);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                uint32_t body = read_uleb(&s);
+                if (body > s.size - s.pos)
+                    fail("corpo de função truncado", NULL);
+                functions[i].body = s.pos;
+                functions[i].size = body;
+                s.pos += body;
+            }
+        }
+        else if (id == 11) // data
+        {
+            for (uint32_t count = read_uleb(&s); count > 0; --count)
+            {
+                Segment segment = {0};
+                uint32_t flags = read_uleb(&s);
+                if (flags == 2)
+                    read_uleb(&s);
+                if (flags != 1)
+                {
+                    int64_t offset = read_const_expr(&s);
+                    segment.active = offset >= 0;
+                    segment.offset = segment.active ? (uint32_t)offset : 0;
+                }
+                segment.size = read_uleb(&s);
+                s.pos += segment.size;
+                if (segment_count < MAX_SEGMENTS)
+                    segments[segment_count] = segment;
+                segment_count++;
+            }
+        }
+        else if (id == 0) // custom
+        {
+            uint32_t length;
+            const char *name = read_name(&s, &length);
+            if (!name_is(name, length, "name"))
+                continue;
+            while (s.pos < s.size)
+            {
+                uint8_t kind = read_byte(&s);
+                uint32_t sub_size = read_uleb(&s);
+                Reader n = {file, s.pos + sub_size, s.pos};
+                s.pos += sub_size;
+                if (kind != 1 && kind != 7 && kind != 9) // funções, globais, segmentos
+                    continue;
+                for (uint32_t count = read_uleb(&n); count > 0; --count)
+                {
+                    uint32_t index = read_uleb(&n), name_size;
+                    const char *entry = read_name(&n, &name_size);
+                    if (kind == 1 && index >= imported_functions && index - imported_functions < function_count)
+                    {
+                        functions[index - imported_functions].name = entry;
+                        functions[index - imported_functions].name_size = name_size;
+                    }
+                    else if (kind == 7 && name_is(entry, name_size, "__stack_pointer"))
+                        stack_pointer = index;
+                    else if (kind == 9 && index < segment_count && index < MAX_SEGMENTS)
+                    {
+                        segments[index].name = entry;
+                        segments[index].name_size = name_size;
+                    }
+                }
+            }
+        }
+    }
+
+    // Sem nomes de globais, __stack_pointer é o primeiro global mutável
+    for (uint32_t i = 0; stack_pointer < 0 && i < global_count && i < MAX_GLOBALS; ++i)
+    {
+        if (global_mutable[i])
+            stack_pointer = i;
+    }
+    int64_t stack_top = stack_pointer >= 0 && stack_pointer < MAX_GLOBALS ? global_value[stack_pointer] : -1;
+
+    for (uint32_t i = 0; i < function_count && have_code && stack_pointer >= 0; ++i)
+        functions[i].frame = stack_frame_size(file + functions[i].body, functions[i].size, (uint32_t)stack_pointer);
+
+    uint32_t code_total = 0;
+    for (uint32_t i = 0; i < function_count; ++i)
+        code_total += functions[i].size;
+
+    if (baseline_out || baseline_in)
+    {
+        int status = 0;
+        if (baseline_out)
+            write_baseline(baseline_out, stripped, code_total, functions, function_count);
+        else
+            status = compare_baseline(baseline_in, stripped, code_total, functions, function_count, show, tolerance);
+        free(functions);
+        free(file);
+        return status;
+    }
+
+    // --- Relatório ---
+
+    printf("%s: %zu bytes\n", path, file_size);
+    printf("sections:");
+    for (int id = 1; id < 13; ++id)
+    {
+        if (section_size[id])
+            printf(" %s %u", section_names[id], section_size[id]);
+    }
+    if (section_size[0])
+        printf(" custom %u", section_size[0]);
+    printf("\n\n");
+
+    uint32_t initialized = 0, zeroed = 0, data_start = UINT32_MAX;
+    for (uint32_t i = 0; i < segment_count && i < MAX_SEGMENTS; ++i)
+    {
+        if (name_is(segments[i].name, segments[i].name_size, ".bss"))
+            zeroed += segments[i].size;
+        else
+            initialized += segments[i].size;
+        if (segments[i].active && segments[i].offset < data_start)
+            data_start = segments[i].offset;
+    }
+    if (data_start == UINT32_MAX)
+        data_start = stack_top > 0 ? (uint32_t)stack_top : FRAMEBUFFER_END;
+    uint32_t static_end = heap_base >= 0 ? (uint32_t)heap_base : data_end >= 0 ? (uint32_t)data_end : 0;
+    if (static_end > data_start && static_end - data_start > initialized)
+        zeroed = static_end - data_start - initialized;
+
+    printf("memory (%u bytes):\n", MEMORY_SIZE);
+    printf("  %-30s 0x0000-0x%04x %6u\n", "registers + framebuffer", FRAMEBUFFER_END, FRAMEBUFFER_END);
+    if (stack_top > FRAMEBUFFER_END)
+        printf("  %-30s 0x%04x-0x%04x %6u\n", "stack (grows down)", FRAMEBUFFER_END, (uint32_t)stack_top,
+               (uint32_t)stack_top - FRAMEBUFFER_END);
+    printf("  %-30s 0x%04x-0x%04x %6u  (%u segments)\n", "data (initialized)", data_start, data_start + initialized,
+           initialized, segment_count);
+    if (static_end)
+    {
+        printf("  %-30s 0x%04x-0x%04x %6u\n", "bss (zeroed)", data_start + initialized, static_end, zeroed);
+        printf("  %-30s 0x%04x-0x%05x %6u  (%.1f%% of memory)\n", "free", static_end, MEMORY_SIZE,
+               MEMORY_SIZE - static_end, 100.0 * (MEMORY_SIZE - static_end) / MEMORY_SIZE);
+    }
+    else
+    {
+        printf("  (export __heap_base or __data_end to see bss and free memory)\n");
+    }
+    printf("  stack peak: build with DEBUG=1 and read the \"stack:\" line in the w4 console\n\n");
+
+    qsort(functions, function_count, sizeof(Function), compare_functions);
+    printf("code: %u bytes in %u functions\n", code_total, function_count);
+    printf("  %6s %6s  %s\n", "bytes", "frame", "function");
+    for (uint32_t i = 0; i < function_count && (show <= 0 || i < (uint32_t)show); ++i)
+    {
+        const Function *f = &functions[i];
+        if (f->name)
+            printf("  %6u %6u  %.*s\n", f->size, f->frame, (int)f->name_size, f->name);
+        else
+            printf("  %6u %6u  function[%u]\n", f->size, f->frame, f->index);
+    }
+    if (show > 0 && function_count > (uint32_t)show)
+        printf("  ... %u more (-n 0 lists all)\n", function_count - (uint32_t)show);
+
+    free(functions);
+    free(file);
+    return 0;
+}